@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+#define CACHE_LINE 64
+#define HUGE_PAGE (2UL<<20)
+#define SLOT_SIZE ((sizeof(CPU)+CACHE_LINE-1) & ~(unsigned long)(CACHE_LINE-1))
+
+struct Arena
+{
+	uint8_t* base; /* Slots, aligned to a huge page */
+	void* map; /* What to munmap, base may sit inside it */
+	unsigned long map_len;
+	unsigned int* free; /* Stack of freed slot numbers */
+	unsigned int nfree;
+	ArenaStats stats;
+};
+
+/*
+ * Huge pages from the pool when there are any. Otherwise an ordinary
+ * mapping is trimmed to a huge page boundary and left to transparent
+ * huge pages, which back it once it is touched.
+ */
+static void arena_map(Arena* a, unsigned long len)
+{
+	uint8_t* p;
+	unsigned long head;
+	a->map=mmap(0, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+	if(a->map!=MAP_FAILED)
+	{
+		a->base=a->map;
+		a->map_len=len;
+		a->stats.hugetlb=1;
+		return;
+	}
+	p=mmap(0, len+HUGE_PAGE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if(p==MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to map instance arena\n");
+		exit(EXIT_FAILURE);
+	}
+	head=(HUGE_PAGE-((unsigned long)p & (HUGE_PAGE-1))) & (HUGE_PAGE-1);
+	if(head) munmap(p, head);
+	munmap(p+head+len, HUGE_PAGE-head);
+	a->map=a->base=p+head;
+	a->map_len=len;
+	a->stats.hugetlb=0;
+	madvise(a->base, len, MADV_HUGEPAGE);
+}
+
+Arena* arena_create(unsigned int count)
+{
+	Arena* a=calloc(1, sizeof(Arena));
+	unsigned long len=(count*SLOT_SIZE+HUGE_PAGE-1) & ~(HUGE_PAGE-1);
+	if(!a || !count || !(a->free=malloc(count*sizeof(unsigned int))))
+	{
+		fprintf(stderr, "Failed to allocate instance arena\n");
+		exit(EXIT_FAILURE);
+	}
+	arena_map(a, len);
+	a->stats.slots=count;
+	a->stats.bytes=len;
+	return a;
+}
+
+void arena_destroy(Arena* a)
+{
+	munmap(a->map, a->map_len);
+	free(a->free);
+	free(a);
+}
+
+/* Clears the state a freed slot carries, its page tables and memory are all set again by mmu_init */
+static void arena_clear(CPU* c)
+{
+	memset(c, 0, offsetof(CPU, MMU));
+	memset(&c->MMU.keys, 0, sizeof(MMU)-offsetof(MMU, keys));
+}
+
+/* A fresh slot is still zero from mmap, a freed one is cleared on its way back out */
+CPU* arena_alloc(Arena* a)
+{
+	ArenaStats* s=&a->stats;
+	CPU* c;
+	if(a->nfree)
+	{
+		c=(CPU*)(a->base+a->free[--a->nfree]*SLOT_SIZE);
+		arena_clear(c);
+		++s->reuses;
+	}
+	else if(s->touched < s->slots) c=(CPU*)(a->base+s->touched++*SLOT_SIZE);
+	else return 0;
+	++s->allocs;
+	if(++s->live > s->peak) s->peak=s->live;
+	return c;
+}
+
+void arena_free(Arena* a, CPU* c)
+{
+	a->free[a->nfree++]=((uint8_t*)c-a->base)/SLOT_SIZE;
+	--a->stats.live;
+}
+
+void arena_stats(const Arena* a, ArenaStats* s)
+{
+	*s=a->stats;
+}
@@ -0,0 +1,37 @@
+#ifndef TAPIBOYARENA
+#define TAPIBOYARENA
+
+#include "cpu.h"
+
+/*
+ * Instances for hosts that run many of them. An arena reserves room for
+ * count CPUs up front in huge pages, so thousands of instances sit in a
+ * few TLB entries. Every CPU starts on a cache line and its state reads
+ * as zeros when it is handed out, the page tables and memory are left to
+ * mmu_init. Freed slots go on a list kept outside the slots
+ * and are handed out again before fresh ones, so the arena only ever
+ * touches pages that are already backed. Like ROM images, an arena is
+ * not thread safe.
+ */
+typedef struct Arena Arena;
+
+typedef struct ArenaStats
+{
+	unsigned int slots; /* CPUs the arena has room for */
+	unsigned int live; /* Handed out and not freed yet */
+	unsigned int peak; /* Most live at once */
+	unsigned int touched; /* Slots that have been handed out at least once */
+	unsigned long allocs;
+	unsigned long reuses; /* Allocations served from freed slots */
+	unsigned long bytes; /* Reserved */
+	uint8_t hugetlb; /* 1 with MAP_HUGETLB pages, 0 when transparent huge pages were asked for */
+} ArenaStats;
+
+Arena* arena_create(unsigned int count);
+void arena_destroy(Arena* a);
+CPU* arena_alloc(Arena* a); /* 0 when every slot is live */
+/* Only gives the memory back, eject the cart and destroy the block cache or JIT first */
+void arena_free(Arena* a, CPU* c);
+void arena_stats(const Arena* a, ArenaStats* s);
+
+#endif
@@ -0,0 +1,524 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cart.h"
+
+#define ROM_BANK 0x4000
+#define RAM_BANK 0x2000
+#define ROM_MAX (512*ROM_BANK) /* Largest MBC5 cart */
+
+#define FLUSH_QUEUE 64 /* Writebacks waiting for the helper thread */
+
+#define HDR_TYPE 0x147
+#define HDR_RAM 0x149
+
+/* 8K RAM banks for the RAM size byte of the header, 2K carts get a whole bank */
+static const uint8_t RamBanks[6]={0, 1, 1, 4, 16, 8};
+
+struct Rom
+{
+	uint8_t* data; /* Mapped read only */
+	unsigned int banks; /* 16K banks, a power of two */
+	unsigned int refs;
+	uint64_t paged[ROM_MAX/ROM_BANK/64]; /* Banks that have been read at least once */
+	uint8_t mbc; /* Header fields, checked once when the image is opened */
+	uint8_t ram_banks;
+	uint8_t battery; /* RAM is kept in a save file */
+	dev_t dev; /* File the image was read from, 0 and 0 for rom_create */
+	ino_t ino;
+	struct Rom* next;
+};
+
+static Rom* Roms; /* Images read from files, for rom_open to share */
+
+static uint8_t cart_mbc(uint8_t type)
+{
+	switch(type)
+	{
+		case 0x00: case 0x08: case 0x09:
+			return MBC_NONE;
+		case 0x01: case 0x02: case 0x03:
+			return MBC1;
+		case 0x0F: case 0x10: case 0x11: case 0x12: case 0x13:
+			return MBC3;
+		case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E:
+			return MBC5;
+	}
+	fprintf(stderr, "Unsupported cartridge type: 0x%02x\n", type);
+	exit(EXIT_FAILURE);
+}
+
+static uint8_t cart_battery(uint8_t type)
+{
+	switch(type)
+	{
+		case 0x03: case 0x09: case 0x0F: case 0x10: case 0x13: case 0x1B: case 0x1E:
+			return 1;
+	}
+	return 0;
+}
+
+/* Rounded up to a power of two so bank numbers can be masked */
+static Rom* rom_new(long size, const char* name)
+{
+	Rom* r;
+	if(size <= HDR_RAM || size > ROM_MAX)
+	{
+		fprintf(stderr, "Invalid rom size %ld: %s\n", size, name);
+		exit(EXIT_FAILURE);
+	}
+	if(!(r=calloc(1, sizeof(Rom))))
+	{
+		fprintf(stderr, "Failed to allocate rom\n");
+		exit(EXIT_FAILURE);
+	}
+	r->banks=2;
+	while(r->banks*ROM_BANK < (unsigned long)size) r->banks<<=1;
+	r->refs=1;
+	return r;
+}
+
+/* Anonymous memory for the whole image, FF past size where the file or buffer ends */
+static void rom_reserve(Rom* r, unsigned long size)
+{
+	r->data=mmap(0, r->banks*ROM_BANK, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if(r->data==MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to allocate rom\n");
+		exit(EXIT_FAILURE);
+	}
+	memset(r->data+size, 0xFF, r->banks*ROM_BANK-size);
+}
+
+/* Pages of the image are never mapped writable, this catches any other store */
+static void rom_seal(Rom* r)
+{
+	mprotect(r->data, r->banks*ROM_BANK, PROT_READ);
+}
+
+static void rom_header(Rom* r)
+{
+	r->mbc=cart_mbc(r->data[HDR_TYPE]);
+	r->ram_banks=r->data[HDR_RAM] < sizeof(RamBanks) ? RamBanks[r->data[HDR_RAM]] : 0;
+	r->battery=cart_battery(r->data[HDR_TYPE]);
+}
+
+Rom* rom_create(const uint8_t* data, unsigned long size)
+{
+	Rom* r=rom_new(size, "buffer");
+	rom_reserve(r, size);
+	memcpy(r->data, data, size);
+	rom_seal(r);
+	rom_header(r);
+	return r;
+}
+
+/*
+ * The file is mapped, not read, so the page cache holds the only copy and
+ * banks are faulted in when they are first run. Carts are a power of two
+ * of banks in practice, anything shorter gets the tail it is missing from
+ * anonymous memory.
+ */
+Rom* rom_open(const char* path)
+{
+	struct stat st;
+	unsigned long whole;
+	Rom* r;
+	int fd=open(path, O_RDONLY);
+	if(fd < 0 || fstat(fd, &st))
+	{
+		fprintf(stderr, "Failed to open rom: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+	for(r=Roms; r; r=r->next)
+	{
+		if(r->dev==st.st_dev && r->ino==st.st_ino)
+		{
+			close(fd);
+			++r->refs;
+			return r;
+		}
+	}
+	r=rom_new(st.st_size, path);
+	if(r->banks*ROM_BANK==(unsigned long)st.st_size)
+	{
+		r->data=mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(r->data==MAP_FAILED)
+		{
+			fprintf(stderr, "Failed to map rom: %s\n", path);
+			exit(EXIT_FAILURE);
+		}
+	}
+	else
+	{
+		/* Whole host pages of the file go over the reservation, the rest is copied */
+		whole=st.st_size & ~(sysconf(_SC_PAGESIZE)-1);
+		rom_reserve(r, st.st_size);
+		if(pread(fd, r->data+whole, st.st_size-whole, whole)!=st.st_size-(long)whole
+				|| (whole && mmap(r->data, whole, PROT_READ, MAP_PRIVATE|MAP_FIXED, fd, 0)==MAP_FAILED))
+		{
+			fprintf(stderr, "Failed to map rom: %s\n", path);
+			exit(EXIT_FAILURE);
+		}
+		rom_seal(r);
+	}
+	close(fd);
+	/* Readahead would pull in the banks around every fault, see rom_bank_in */
+	madvise(r->data, r->banks*ROM_BANK, MADV_RANDOM);
+	rom_header(r);
+	r->dev=st.st_dev;
+	r->ino=st.st_ino;
+	r->next=Roms;
+	Roms=r;
+	return r;
+}
+
+void rom_release(Rom* r)
+{
+	Rom** p;
+	if(--r->refs) return;
+	for(p=&Roms; *p; p=&(*p)->next)
+	{
+		if(*p==r)
+		{
+			*p=r->next;
+			break;
+		}
+	}
+	munmap(r->data, r->banks*ROM_BANK);
+	free(r);
+}
+
+/*
+ * Large carts are mostly banks a session never runs, and games switch
+ * through banks they do not read from, so a bank is only read in on its
+ * first access. Until then its window is left to rom_read, which reads
+ * the 16K ahead in one go and maps it. After that the page cache keeps the
+ * hot banks and may drop cold ones, which fault back in from the file.
+ * The bitmap is shared like the image, a lost update only costs another
+ * madvise.
+ */
+static int rom_paged(const Rom* r, unsigned int bank)
+{
+	return (r->paged[bank>>6]>>(bank&63))&1;
+}
+
+static void rom_bank_in(Rom* r, unsigned int bank)
+{
+	r->paged[bank>>6]|=(uint64_t)1<<(bank&63);
+	madvise(r->data+bank*ROM_BANK, ROM_BANK, MADV_WILLNEED);
+}
+
+/* Bank the window at base shows, only MBC1 in mode 1 moves bank 0 */
+static unsigned int cart_bank(const Cart* k, uint16_t base)
+{
+	unsigned int bank=0;
+	if(base==0x4000)
+	{
+		bank=k->rom_bank;
+		if(k->mbc==MBC1) bank|=k->ram_bank<<5;
+	}
+	else if(k->mbc==MBC1 && k->mode) bank=k->ram_bank<<5;
+	return bank&(k->rom->banks-1);
+}
+
+static void cart_map_window(MMU* m, uint16_t base)
+{
+	Rom* r=m->cart.rom;
+	unsigned int bank=cart_bank(&m->cart, base);
+	mmu_map(m, base, ROM_BANK, rom_paged(r, bank) ? r->data+bank*ROM_BANK : 0, 0);
+}
+
+static void cart_map_rom0(MMU* m)
+{
+	cart_map_window(m, 0x0000);
+}
+
+static void cart_map_rom(MMU* m)
+{
+	cart_map_window(m, 0x4000);
+}
+
+/* Disabled RAM and the MBC3 clock registers are left to the callbacks below */
+static void cart_map_ram(MMU* m)
+{
+	Cart* k=&m->cart;
+	unsigned int bank=k->ram_bank;
+	if(k->mbc==MBC1 && !k->mode) bank=0;
+	if(k->ram && k->ram_on && !(k->mbc==MBC3 && bank >= 8))
+	{
+		uint8_t* p=k->ram+(bank&(k->ram_banks-1))*RAM_BANK;
+		mmu_map(m, 0xA000, RAM_BANK, p, p);
+	}
+	else mmu_map(m, 0xA000, RAM_BANK, 0, 0);
+}
+
+static int cart_rtc(Cart* k)
+{
+	return k->mbc==MBC3 && k->ram_on && k->ram_bank >= 8 && k->ram_bank <= 0x0C;
+}
+
+static uint8_t ram_read(MMU* m, uint16_t addr)
+{
+	if(cart_rtc(&m->cart)) return m->cart.rtc[m->cart.ram_bank-8];
+	return 0xFF; /* Nothing drives the bus */
+}
+
+static void ram_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	if(cart_rtc(&m->cart)) m->cart.rtc[m->cart.ram_bank-8]=val;
+}
+
+/* First access to a bank, or the cart is ejected */
+static uint8_t rom_read(MMU* m, uint16_t addr)
+{
+	Cart* k=&m->cart;
+	unsigned int base=addr&~(ROM_BANK-1), bank, i;
+	if(!k->rom) return 0xFF; /* Nothing drives the bus */
+	bank=cart_bank(k, base);
+	rom_bank_in(k->rom, bank);
+	/* Pages mapped over the window, like the boot ROM, stay */
+	for(i=0; i<ROM_BANK; i+=PAGE_SIZE)
+	{
+		if(!m->rd[(base+i)>>PAGE_SHIFT]) mmu_map(m, base+i, PAGE_SIZE, k->rom->data+bank*ROM_BANK+i, 0);
+	}
+	return mmu_read(m, addr);
+}
+
+/* Writes to ROM set the mapper registers */
+static void cart_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	Cart* k=&m->cart;
+	if(k->mbc==MBC_NONE) return;
+	switch(addr>>13)
+	{
+		case 0: /* 0000-1FFF: RAM enable */
+			k->ram_on=(val&0x0F)==0x0A;
+			cart_map_ram(m);
+			break;
+		case 1: /* 2000-3FFF: ROM bank */
+			if(k->mbc==MBC5)
+			{
+				if(addr < 0x3000) k->rom_bank=(k->rom_bank&0x100)|val;
+				else k->rom_bank=(k->rom_bank&0xFF)|((val&1)<<8);
+			}
+			else
+			{
+				k->rom_bank=val&(k->mbc==MBC1 ? 0x1F : 0x7F);
+				if(!k->rom_bank) k->rom_bank=1;
+			}
+			cart_map_rom(m);
+			break;
+		case 2: /* 4000-5FFF: RAM bank, upper ROM bank bits on MBC1 */
+			k->ram_bank=val&(k->mbc==MBC1 ? 0x03 : 0x0F);
+			if(k->mbc==MBC1)
+			{
+				cart_map_rom0(m);
+				cart_map_rom(m);
+			}
+			cart_map_ram(m);
+			break;
+		case 3: /* 6000-7FFF: MBC1 banking mode, MBC3 clock latch */
+			if(k->mbc==MBC1)
+			{
+				k->mode=val&1;
+				cart_map_rom0(m);
+				cart_map_ram(m);
+			}
+			else if(k->mbc==MBC3)
+			{
+				/* 0 then 1 latches the clock, it does not run yet so there is nothing to copy */
+				k->latch=val;
+			}
+			break;
+	}
+}
+
+/*
+ * Battery RAM is a shared mapping of the save file, so a game saving is
+ * only stores to memory and the kernel writes the pages back on its own.
+ * A file shorter than the RAM is extended with zeros, a longer one keeps
+ * whatever follows.
+ */
+static void cart_map_save(Cart* k, const char* save)
+{
+	struct stat st;
+	unsigned long size=k->ram_banks*RAM_BANK;
+	k->save_fd=open(save, O_RDWR|O_CREAT, 0644);
+	if(k->save_fd < 0 || fstat(k->save_fd, &st)
+			|| (st.st_size < (long)size && ftruncate(k->save_fd, size))
+			|| (k->ram=mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, k->save_fd, 0))==MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to map save file: %s\n", save);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void cart_insert(MMU* m, Rom* r, const char* save)
+{
+	Cart* k=&m->cart;
+	cart_eject(m);
+	++r->refs;
+	k->rom=r;
+	k->mbc=r->mbc;
+	k->ram_banks=r->ram_banks;
+	k->save_fd=-1;
+	if(k->ram_banks && r->battery && save) cart_map_save(k, save);
+	else if(k->ram_banks && !(k->ram=calloc(k->ram_banks, RAM_BANK)))
+	{
+		fprintf(stderr, "Failed to allocate cartridge ram\n");
+		exit(EXIT_FAILURE);
+	}
+	k->ram_on=k->mbc==MBC_NONE;
+	k->mode=0;
+	k->rom_bank=1;
+	k->ram_bank=0;
+	k->latch=0;
+	memset(k->rtc, 0, sizeof(k->rtc));
+
+	mmu_map_io(m, 0x0000, 0x8000, rom_read, cart_write);
+	mmu_map_io(m, 0xA000, RAM_BANK, ram_read, ram_write);
+	cart_remap(m);
+}
+
+/* The save file is the rom path with its extension replaced by .sav */
+void cart_load(MMU* m, const char* path)
+{
+	Rom* r=rom_open(path);
+	const char* ext=strrchr(path, '.');
+	size_t len=ext && !strchr(ext, '/') ? (size_t)(ext-path) : strlen(path);
+	char* save=malloc(len+sizeof(".sav"));
+	if(!save)
+	{
+		fprintf(stderr, "Failed to allocate save path\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(save, path, len);
+	strcpy(save+len, ".sav");
+	cart_insert(m, r, save);
+	free(save);
+	rom_release(r);
+}
+
+/*
+ * Writeback queue. Every request holds its own dup of the save file, so a
+ * cart can be ejected and close its descriptor while a request is queued.
+ */
+static pthread_mutex_t FlushLock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t FlushWake=PTHREAD_COND_INITIALIZER;
+static pthread_cond_t FlushDone=PTHREAD_COND_INITIALIZER;
+static int FlushFds[FLUSH_QUEUE];
+static unsigned int FlushHead, FlushCount;
+static int FlushBusy, FlushStarted;
+
+static void* flush_thread(void* arg)
+{
+	pthread_mutex_lock(&FlushLock);
+	for(;;)
+	{
+		int fd;
+		while(!FlushCount) pthread_cond_wait(&FlushWake, &FlushLock);
+		fd=FlushFds[FlushHead];
+		FlushHead=(FlushHead+1)%FLUSH_QUEUE;
+		--FlushCount;
+		FlushBusy=1;
+		pthread_mutex_unlock(&FlushLock);
+		fdatasync(fd); /* Shared mappings are written back along with the file */
+		close(fd);
+		pthread_mutex_lock(&FlushLock);
+		FlushBusy=0;
+		if(!FlushCount) pthread_cond_broadcast(&FlushDone);
+	}
+	return 0;
+}
+
+/* Returns 0 when the helper thread could not take it */
+static int flush_queue(int fd)
+{
+	int ok=0;
+	int copy=dup(fd);
+	if(copy < 0) return 0;
+	pthread_mutex_lock(&FlushLock);
+	if(!FlushStarted)
+	{
+		pthread_t t;
+		if(!pthread_create(&t, 0, flush_thread, 0))
+		{
+			pthread_detach(t);
+			FlushStarted=1;
+		}
+	}
+	if(FlushStarted && FlushCount < FLUSH_QUEUE)
+	{
+		FlushFds[(FlushHead+FlushCount++)%FLUSH_QUEUE]=copy;
+		pthread_cond_signal(&FlushWake);
+		ok=1;
+	}
+	pthread_mutex_unlock(&FlushLock);
+	if(!ok) close(copy);
+	return ok;
+}
+
+/* Drops the request when the queue is full, there is another one coming */
+void cart_flush(MMU* m)
+{
+	Cart* k=&m->cart;
+	if(k->save_fd >= 0) flush_queue(k->save_fd);
+}
+
+void cart_frame(MMU* m)
+{
+	Cart* k=&m->cart;
+	if(k->flush_frames && ++k->frames >= k->flush_frames)
+	{
+		cart_flush(m);
+		k->frames=0;
+	}
+}
+
+void cart_flush_every(MMU* m, unsigned int frames)
+{
+	m->cart.flush_frames=frames;
+	m->cart.frames=0;
+}
+
+void cart_wait(void)
+{
+	pthread_mutex_lock(&FlushLock);
+	while(FlushCount || FlushBusy) pthread_cond_wait(&FlushDone, &FlushLock);
+	pthread_mutex_unlock(&FlushLock);
+}
+
+void cart_eject(MMU* m)
+{
+	Cart* k=&m->cart;
+	if(!k->rom) return;
+	rom_release(k->rom);
+	if(k->save_fd >= 0)
+	{
+		/* The pages stay dirty in the file after munmap, the last writeback gets them */
+		if(!flush_queue(k->save_fd)) fdatasync(k->save_fd);
+		munmap(k->ram, k->ram_banks*RAM_BANK);
+		close(k->save_fd);
+		k->save_fd=-1;
+	}
+	else free(k->ram);
+	k->rom=0;
+	k->ram=0;
+	k->ram_banks=0;
+	k->mbc=MBC_NONE;
+	mmu_map(m, 0x0000, 0x8000, 0, 0);
+	cart_map_ram(m);
+}
+
+void cart_remap(MMU* m)
+{
+	cart_map_rom0(m);
+	cart_map_rom(m);
+	cart_map_ram(m);
+}
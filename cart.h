@@ -0,0 +1,48 @@
+#ifndef TAPIBOYCART
+#define TAPIBOYCART
+
+#include "mmu.h"
+
+#define MBC_NONE 0
+#define MBC1 1
+#define MBC3 3
+#define MBC5 5
+
+/*
+ * A ROM image is loaded once and mapped read only into every cartridge
+ * it is inserted in, so instances running the same game share it and
+ * only their RAM is their own. rom_open hands out the image that is
+ * already open for a file. Images are reference counted, which is not
+ * thread safe: open, insert and release them from one thread.
+ */
+typedef struct Rom Rom;
+
+Rom* rom_open(const char* path);
+Rom* rom_create(const uint8_t* data, unsigned long size);
+void rom_release(Rom* r);
+
+/*
+ * 0000-3FFF and 4000-7FFF point at banks of the ROM, a bank switch only
+ * repoints those pages, likewise external RAM at A000-BFFF. A cart takes
+ * its own reference to the image. Battery backed RAM is mapped from save,
+ * without a save file it is lost on eject like any other RAM. cart_load
+ * keeps the save next to the rom.
+ */
+void cart_insert(MMU* m, Rom* r, const char* save);
+void cart_load(MMU* m, const char* path);
+void cart_eject(MMU* m); /* Queues a last writeback of the save file */
+void cart_remap(MMU* m); /* Points the windows back at the selected banks */
+
+/*
+ * Save files are written back by a helper thread, the emulation thread
+ * only queues them. run_frame calls cart_frame, which queues a writeback
+ * every flush_frames frames. cart_wait blocks until everything queued so
+ * far is on the disk, hosts call it after ejecting on their way out.
+ */
+#define SAVE_FLUSH_DEFAULT 300 /* Frames, about five seconds */
+void cart_flush(MMU* m);
+void cart_frame(MMU* m);
+void cart_flush_every(MMU* m, unsigned int frames); /* 0 leaves writeback to the kernel */
+void cart_wait(void);
+
+#endif
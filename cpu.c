@@ -1,10 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <signal.h>
 #include "cpu.h"
+#include "cart.h"
+#include "arena.h"
+#include "sched.h"
+#include "irq.h"
 #include "bios.h"
+#ifdef JIT
+#include "jit.h"
+#endif
 
 #define CYCLES(X) (c->c+=X)
+#define TAKEN(op) CYCLES(OpInfos[op].taken-OpInfos[op].cycles) /* On top of what the dispatch charges */
 #define WORD(X,Y) ((X<<8)|Y)
 #define SET_N(val) (val |= SUBTRACT)
 #define RESET_N(val) (val &= ~SUBTRACT)
@@ -21,7 +30,564 @@
 
 #include <assert.h>
 
-uint8_t inc(uint8_t* reg, uint8_t* flags)
+OpCode OpCodes[256]={
+    &NOP, &LDBCnn, &LDBCA, &INCBC, &INCB, &DECB, &LDBn, &RLCA, &LDnnSP, &ADDHLBC, &LDABC, &DECBC, &INCC, &DECC, &LDCn, &RRCA,
+    &STOP, &LDDEnn, &LDDEA, &INCDE, &INCD, &DECD, &LDDn, &RLA, &JRn, &ADDHLDE, &LDADE, &DECDE, &INCE, &DECE, &LDEn, &RRA,
+    &JRNZn, &LDHLnn, &LDIHLA, &INCHL, &INCH, &DECH, &LDHn, &DAA, &JRZn, &ADDHLHL, &LDIAHL, &DECHL, &INCL, &DECL, &LDLn, &CPL,
+    &JRNCn, &LDSPnn, &LDDHLA, &INCSP, &INCHL2, &DECHL2, &LDHLn, &SCF, &JRCn, &ADDHLSP, &LDDAHL, &DECSP, &INCA, &DECA, &LDAn, &CCF, 
+    &LDBB, &LDBC, &LDBD, &LDBE, &LDBH, &LDBL, &LDBHL, &LDBA, &LDCB, &LDCC, &LDCD, &LDCE, &LDCH, &LDCL, &LDCHL, &LDCA, 
+    &LDDB, &LDDC, &LDDD, &LDDE, &LDDH, &LDDL, &LDDHL, &LDDA, &LDEB, &LDEC, &LDED, &LDEE, &LDEH, &LDEL, &LDEHL, &LDEA, 
+    &LDHB, &LDHC, &LDHD, &LDHE, &LDHH, &LDHL, &LDHHL, &LDHA, &LDLB, &LDLC, &LDLD, &LDLE, &LDLH, &LDLL, &LDLHL, &LDLA, 
+    &LDHLB, &LDHLC, &LDHLD, &LDHLE, &LDHLH, &LDHLL, &HALT, &LDHLA, &LDAB, &LDAC, &LDAD, &LDAE, &LDAH, &LDAL, &LDAHL, &LDAA, 
+    &ADDAB, &ADDAC, &ADDAD, &ADDAE, &ADDAH, &ADDAL, &ADDAHL, &ADDAA, &ADCAB, &ADCAC, &ADCAD, &ADCAE, &ADCAH, &ADCAL, &ADCAHL, &ADCAA, 
+    &SUBAB, &SUBAC, &SUBAD, &SUBAE, &SUBAH, &SUBAL, &SUBAHL, &SUBAA, &SBCAB, &SBCAC, &SBCAD, &SBCAE, &SBCAH, &SBCAL, &SBCAHL, &SBCAA, 
+    &ANDB, &ANDC, &ANDD, &ANDE, &ANDH, &ANDL, &ANDHL, &ANDA, &XORB, &XORC, &XORD, &XORE, &XORH, &XORL, &XORHL, &XORA, 
+    &ORB, &ORC, &ORD, &ORE, &ORH, &ORL, &ORHL, &ORA, &CPB, &CPC, &CPD, &CPE, &CPH, &CP_L, &CPHL, &CPA, 
+    &RETNZ, &POPBC, &JPNZnn, &JPnn, &CALLNZnn, &PUSHBC, &ADDAn, &RST0, &RETZ, &RET, &JPZnn, &Extops, &CALLZnn, &CALLnn, &ADCAn, &RST8, 
+    &RETNC, &POPDE, &JPNCnn, 0, &CALLNCnn, &PUSHDE, &SUBAn, &RST10, &RETC, &RETI, &JPCnn, 0, &CALLCnn, 0, &SBCAn, &RST18, 
+    &LDHnA, &POPHL, &LDHCA, 0, 0, &PUSHHL, &ANDn, &RST20, &ADDSPd, &JPHL, &LDnnA, 0, 0, 0, &XORn, &RST28, 
+    &LDHAn, &POPAF, 0, &DI, 0, &PUSHAF, &ORn, &RST30, &LDHLSPd, &LDSPHL, &LDAnn, &EI, 0, 0, &CPn, &RST38
+};
+
+OpCode ExtOps[256]={
+	&RLCB, &RLCC, &RLCD, &RLCE, &RLCH, &RLCL, &RLCHL, &RLCAext, &RRCB, &RRCC, &RRCD, &RRCE, &RRCH, &RRCL, &RRCHL, &RRCAext,
+	&RLB, &RLC, &RLD, &RLE, &RLH, &RLL, &RLHL, &RLAext, &RRB, &RRC, &RRD, &RRE, &RRH, &RRL, &RRHL, &RRAext,
+	&SLAB, &SLAC, &SLAD, &SLAE, &SLAH, &SLAL, &SLAHL, &SLAA, &SRAB, &SRAC, &SRAD, &SRAE, &SRAH, &SRAL, &SRAHL, &SRAA,
+	&SWAPB, &SWAPC, &SWAPD, &SWAPE, &SWAPH, &SWAPL, &SWAPHL, &SWAPA, &SRLB, &SRLC, &SRLD, &SRLE, &SRLH, &SRLL, &SRLHL, &SRLA,
+	&BIT0B, &BIT0C, &BIT0D, &BIT0E, &BIT0H, &BIT0L, &BIT0HL, &BIT0A, &BIT1B, &BIT1C, &BIT1D, &BIT1E, &BIT1H, &BIT1L, &BIT1HL, &BIT1A,
+	&BIT2B, &BIT2C, &BIT2D, &BIT2E, &BIT2H, &BIT2L, &BIT2HL, &BIT2A, &BIT3B, &BIT3C, &BIT3D, &BIT3E, &BIT3H, &BIT3L, &BIT3HL, &BIT3A,
+	&BIT4B, &BIT4C, &BIT4D, &BIT4E, &BIT4H, &BIT4L, &BIT4HL, &BIT4A, &BIT5B, &BIT5C, &BIT5D, &BIT5E, &BIT5H, &BIT5L, &BIT5HL, &BIT5A,
+	&BIT6B, &BIT6C, &BIT6D, &BIT6E, &BIT6H, &BIT6L, &BIT6HL, &BIT6A, &BIT7B, &BIT7C, &BIT7D, &BIT7E, &BIT7H, &BIT7L, &BIT7HL, &BIT7A,
+	&RES0B, &RES0C, &RES0D, &RES0E, &RES0H, &RES0L, &RES0HL, &RES0A, &RES1B, &RES1C, &RES1D, &RES1E, &RES1H, &RES1L, &RES1HL, &RES1A,
+	&RES2B, &RES2C, &RES2D, &RES2E, &RES2H, &RES2L, &RES2HL, &RES2A, &RES3B, &RES3C, &RES3D, &RES3E, &RES3H, &RES3L, &RES3HL, &RES3A,
+	&RES4B, &RES4C, &RES4D, &RES4E, &RES4H, &RES4L, &RES4HL, &RES4A, &RES5B, &RES5C, &RES5D, &RES5E, &RES5H, &RES5L, &RES5HL, &RES5A,
+	&RES6B, &RES6C, &RES6D, &RES6E, &RES6H, &RES6L, &RES6HL, &RES6A, &RES7B, &RES7C, &RES7D, &RES7E, &RES7H, &RES7L, &RES7HL, &RES7A,
+	&SET0B, &SET0C, &SET0D, &SET0E, &SET0H, &SET0L, &SET0HL, &SET0A, &SET1B, &SET1C, &SET1D, &SET1E, &SET1H, &SET1L, &SET1HL, &SET1A,
+	&SET2B, &SET2C, &SET2D, &SET2E, &SET2H, &SET2L, &SET2HL, &SET2A, &SET3B, &SET3C, &SET3D, &SET3E, &SET3H, &SET3L, &SET3HL, &SET3A,
+	&SET4B, &SET4C, &SET4D, &SET4E, &SET4H, &SET4L, &SET4HL, &SET4A, &SET5B, &SET5C, &SET5D, &SET5E, &SET5H, &SET5L, &SET5HL, &SET5A,
+	&SET6B, &SET6C, &SET6D, &SET6E, &SET6H, &SET6L, &SET6HL, &SET6A, &SET7B, &SET7C, &SET7D, &SET7E, &SET7H, &SET7L, &SET7HL, &SET7A
+};
+
+/* Generated from the opcode map, see OpInfo in cpu.h */
+const OpInfo OpInfos[256]={
+	{"NOP", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 00 */
+	{"LD BC,nn", 3, 12, 0, OPND_IMM16, 0, 0, FLOW_NONE}, /* 01 */
+	{"LD (BC),A", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 02 */
+	{"INC BC", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 03 */
+	{"INC B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 04 */
+	{"DEC B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 05 */
+	{"LD B,n", 2, 8, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 06 */
+	{"RLCA", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 07 */
+	{"LD (nn),SP", 3, 20, 0, OPND_IMM16, 0, 0, FLOW_NONE}, /* 08 */
+	{"ADD HL,BC", 1, 8, 0, OPND_NONE, 0, SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 09 */
+	{"LD A,(BC)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 0A */
+	{"DEC BC", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 0B */
+	{"INC C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 0C */
+	{"DEC C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 0D */
+	{"LD C,n", 2, 8, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 0E */
+	{"RRCA", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 0F */
+	{"STOP", 2, 4, 0, OPND_NONE, 0, 0, FLOW_STOP}, /* 10 */
+	{"LD DE,nn", 3, 12, 0, OPND_IMM16, 0, 0, FLOW_NONE}, /* 11 */
+	{"LD (DE),A", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 12 */
+	{"INC DE", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 13 */
+	{"INC D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 14 */
+	{"DEC D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 15 */
+	{"LD D,n", 2, 8, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 16 */
+	{"RLA", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 17 */
+	{"JR e", 2, 12, 0, OPND_REL8, 0, 0, FLOW_JUMP}, /* 18 */
+	{"ADD HL,DE", 1, 8, 0, OPND_NONE, 0, SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 19 */
+	{"LD A,(DE)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 1A */
+	{"DEC DE", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 1B */
+	{"INC E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 1C */
+	{"DEC E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 1D */
+	{"LD E,n", 2, 8, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 1E */
+	{"RRA", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 1F */
+	{"JR NZ,e", 2, 8, 12, OPND_REL8, ZERO, 0, FLOW_JUMP}, /* 20 */
+	{"LD HL,nn", 3, 12, 0, OPND_IMM16, 0, 0, FLOW_NONE}, /* 21 */
+	{"LD (HL+),A", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 22 */
+	{"INC HL", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 23 */
+	{"INC H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 24 */
+	{"DEC H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 25 */
+	{"LD H,n", 2, 8, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 26 */
+	{"DAA", 1, 4, 0, OPND_NONE, SUBTRACT|HALFCARRY|CARRY, ZERO|HALFCARRY|CARRY, FLOW_NONE}, /* 27 */
+	{"JR Z,e", 2, 8, 12, OPND_REL8, ZERO, 0, FLOW_JUMP}, /* 28 */
+	{"ADD HL,HL", 1, 8, 0, OPND_NONE, 0, SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 29 */
+	{"LD A,(HL+)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 2A */
+	{"DEC HL", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 2B */
+	{"INC L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 2C */
+	{"DEC L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 2D */
+	{"LD L,n", 2, 8, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 2E */
+	{"CPL", 1, 4, 0, OPND_NONE, 0, SUBTRACT|HALFCARRY, FLOW_NONE}, /* 2F */
+	{"JR NC,e", 2, 8, 12, OPND_REL8, CARRY, 0, FLOW_JUMP}, /* 30 */
+	{"LD SP,nn", 3, 12, 0, OPND_IMM16, 0, 0, FLOW_NONE}, /* 31 */
+	{"LD (HL-),A", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 32 */
+	{"INC SP", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 33 */
+	{"INC (HL)", 1, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 34 */
+	{"DEC (HL)", 1, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 35 */
+	{"LD (HL),n", 2, 12, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 36 */
+	{"SCF", 1, 4, 0, OPND_NONE, 0, SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 37 */
+	{"JR C,e", 2, 8, 12, OPND_REL8, CARRY, 0, FLOW_JUMP}, /* 38 */
+	{"ADD HL,SP", 1, 8, 0, OPND_NONE, 0, SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 39 */
+	{"LD A,(HL-)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 3A */
+	{"DEC SP", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 3B */
+	{"INC A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 3C */
+	{"DEC A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 3D */
+	{"LD A,n", 2, 8, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* 3E */
+	{"CCF", 1, 4, 0, OPND_NONE, CARRY, SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 3F */
+	{"LD B,B", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 40 */
+	{"LD B,C", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 41 */
+	{"LD B,D", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 42 */
+	{"LD B,E", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 43 */
+	{"LD B,H", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 44 */
+	{"LD B,L", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 45 */
+	{"LD B,(HL)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 46 */
+	{"LD B,A", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 47 */
+	{"LD C,B", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 48 */
+	{"LD C,C", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 49 */
+	{"LD C,D", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 4A */
+	{"LD C,E", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 4B */
+	{"LD C,H", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 4C */
+	{"LD C,L", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 4D */
+	{"LD C,(HL)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 4E */
+	{"LD C,A", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 4F */
+	{"LD D,B", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 50 */
+	{"LD D,C", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 51 */
+	{"LD D,D", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 52 */
+	{"LD D,E", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 53 */
+	{"LD D,H", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 54 */
+	{"LD D,L", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 55 */
+	{"LD D,(HL)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 56 */
+	{"LD D,A", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 57 */
+	{"LD E,B", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 58 */
+	{"LD E,C", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 59 */
+	{"LD E,D", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 5A */
+	{"LD E,E", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 5B */
+	{"LD E,H", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 5C */
+	{"LD E,L", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 5D */
+	{"LD E,(HL)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 5E */
+	{"LD E,A", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 5F */
+	{"LD H,B", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 60 */
+	{"LD H,C", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 61 */
+	{"LD H,D", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 62 */
+	{"LD H,E", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 63 */
+	{"LD H,H", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 64 */
+	{"LD H,L", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 65 */
+	{"LD H,(HL)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 66 */
+	{"LD H,A", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 67 */
+	{"LD L,B", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 68 */
+	{"LD L,C", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 69 */
+	{"LD L,D", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 6A */
+	{"LD L,E", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 6B */
+	{"LD L,H", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 6C */
+	{"LD L,L", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 6D */
+	{"LD L,(HL)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 6E */
+	{"LD L,A", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 6F */
+	{"LD (HL),B", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 70 */
+	{"LD (HL),C", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 71 */
+	{"LD (HL),D", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 72 */
+	{"LD (HL),E", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 73 */
+	{"LD (HL),H", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 74 */
+	{"LD (HL),L", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 75 */
+	{"HALT", 1, 4, 0, OPND_NONE, 0, 0, FLOW_STOP}, /* 76 */
+	{"LD (HL),A", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 77 */
+	{"LD A,B", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 78 */
+	{"LD A,C", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 79 */
+	{"LD A,D", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 7A */
+	{"LD A,E", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 7B */
+	{"LD A,H", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 7C */
+	{"LD A,L", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 7D */
+	{"LD A,(HL)", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 7E */
+	{"LD A,A", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 7F */
+	{"ADD A,B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 80 */
+	{"ADD A,C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 81 */
+	{"ADD A,D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 82 */
+	{"ADD A,E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 83 */
+	{"ADD A,H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 84 */
+	{"ADD A,L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 85 */
+	{"ADD A,(HL)", 1, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 86 */
+	{"ADD A,A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 87 */
+	{"ADC A,B", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 88 */
+	{"ADC A,C", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 89 */
+	{"ADC A,D", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 8A */
+	{"ADC A,E", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 8B */
+	{"ADC A,H", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 8C */
+	{"ADC A,L", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 8D */
+	{"ADC A,(HL)", 1, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 8E */
+	{"ADC A,A", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 8F */
+	{"SUB B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 90 */
+	{"SUB C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 91 */
+	{"SUB D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 92 */
+	{"SUB E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 93 */
+	{"SUB H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 94 */
+	{"SUB L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 95 */
+	{"SUB (HL)", 1, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 96 */
+	{"SUB A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 97 */
+	{"SBC A,B", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 98 */
+	{"SBC A,C", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 99 */
+	{"SBC A,D", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 9A */
+	{"SBC A,E", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 9B */
+	{"SBC A,H", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 9C */
+	{"SBC A,L", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 9D */
+	{"SBC A,(HL)", 1, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 9E */
+	{"SBC A,A", 1, 4, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 9F */
+	{"AND B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A0 */
+	{"AND C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A1 */
+	{"AND D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A2 */
+	{"AND E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A3 */
+	{"AND H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A4 */
+	{"AND L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A5 */
+	{"AND (HL)", 1, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A6 */
+	{"AND A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A7 */
+	{"XOR B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A8 */
+	{"XOR C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* A9 */
+	{"XOR D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* AA */
+	{"XOR E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* AB */
+	{"XOR H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* AC */
+	{"XOR L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* AD */
+	{"XOR (HL)", 1, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* AE */
+	{"XOR A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* AF */
+	{"OR B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B0 */
+	{"OR C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B1 */
+	{"OR D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B2 */
+	{"OR E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B3 */
+	{"OR H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B4 */
+	{"OR L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B5 */
+	{"OR (HL)", 1, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B6 */
+	{"OR A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B7 */
+	{"CP B", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B8 */
+	{"CP C", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* B9 */
+	{"CP D", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* BA */
+	{"CP E", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* BB */
+	{"CP H", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* BC */
+	{"CP L", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* BD */
+	{"CP (HL)", 1, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* BE */
+	{"CP A", 1, 4, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* BF */
+	{"RET NZ", 1, 8, 20, OPND_NONE, ZERO, 0, FLOW_JUMP}, /* C0 */
+	{"POP BC", 1, 12, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C1 */
+	{"JP NZ,nn", 3, 12, 16, OPND_IMM16, ZERO, 0, FLOW_JUMP}, /* C2 */
+	{"JP nn", 3, 16, 0, OPND_IMM16, 0, 0, FLOW_JUMP}, /* C3 */
+	{"CALL NZ,nn", 3, 12, 24, OPND_IMM16, ZERO, 0, FLOW_JUMP}, /* C4 */
+	{"PUSH BC", 1, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C5 */
+	{"ADD A,n", 2, 8, 0, OPND_IMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* C6 */
+	{"RST 00H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* C7 */
+	{"RET Z", 1, 8, 20, OPND_NONE, ZERO, 0, FLOW_JUMP}, /* C8 */
+	{"RET", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* C9 */
+	{"JP Z,nn", 3, 12, 16, OPND_IMM16, ZERO, 0, FLOW_JUMP}, /* CA */
+	{"PREFIX CB", 2, 0, 0, OPND_CB, 0, 0, FLOW_NONE}, /* CB */
+	{"CALL Z,nn", 3, 12, 24, OPND_IMM16, ZERO, 0, FLOW_JUMP}, /* CC */
+	{"CALL nn", 3, 24, 0, OPND_IMM16, 0, 0, FLOW_JUMP}, /* CD */
+	{"ADC A,n", 2, 8, 0, OPND_IMM8, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* CE */
+	{"RST 08H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* CF */
+	{"RET NC", 1, 8, 20, OPND_NONE, CARRY, 0, FLOW_JUMP}, /* D0 */
+	{"POP DE", 1, 12, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D1 */
+	{"JP NC,nn", 3, 12, 16, OPND_IMM16, CARRY, 0, FLOW_JUMP}, /* D2 */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D3 */
+	{"CALL NC,nn", 3, 12, 24, OPND_IMM16, CARRY, 0, FLOW_JUMP}, /* D4 */
+	{"PUSH DE", 1, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D5 */
+	{"SUB n", 2, 8, 0, OPND_IMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* D6 */
+	{"RST 10H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* D7 */
+	{"RET C", 1, 8, 20, OPND_NONE, CARRY, 0, FLOW_JUMP}, /* D8 */
+	{"RETI", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* D9 */
+	{"JP C,nn", 3, 12, 16, OPND_IMM16, CARRY, 0, FLOW_JUMP}, /* DA */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DB */
+	{"CALL C,nn", 3, 12, 24, OPND_IMM16, CARRY, 0, FLOW_JUMP}, /* DC */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DD */
+	{"SBC A,n", 2, 8, 0, OPND_IMM8, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* DE */
+	{"RST 18H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* DF */
+	{"LDH (n),A", 2, 12, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* E0 */
+	{"POP HL", 1, 12, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E1 */
+	{"LD (C),A", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E2 */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E3 */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E4 */
+	{"PUSH HL", 1, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E5 */
+	{"AND n", 2, 8, 0, OPND_IMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* E6 */
+	{"RST 20H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* E7 */
+	{"ADD SP,d", 2, 16, 0, OPND_SIMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* E8 */
+	{"JP (HL)", 1, 4, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* E9 */
+	{"LD (nn),A", 3, 16, 0, OPND_IMM16, 0, 0, FLOW_NONE}, /* EA */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* EB */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* EC */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* ED */
+	{"XOR n", 2, 8, 0, OPND_IMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* EE */
+	{"RST 28H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* EF */
+	{"LDH A,(n)", 2, 12, 0, OPND_IMM8, 0, 0, FLOW_NONE}, /* F0 */
+	{"POP AF", 1, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* F1 */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F2 */
+	{"DI", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F3 */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F4 */
+	{"PUSH AF", 1, 16, 0, OPND_NONE, ZERO|SUBTRACT|HALFCARRY|CARRY, 0, FLOW_NONE}, /* F5 */
+	{"OR n", 2, 8, 0, OPND_IMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* F6 */
+	{"RST 30H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP}, /* F7 */
+	{"LD HL,SP+d", 2, 12, 0, OPND_SIMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* F8 */
+	{"LD SP,HL", 1, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F9 */
+	{"LD A,(nn)", 3, 16, 0, OPND_IMM16, 0, 0, FLOW_NONE}, /* FA */
+	{"EI", 1, 4, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FB */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FC */
+	{0, 1, 0, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FD */
+	{"CP n", 2, 8, 0, OPND_IMM8, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* FE */
+	{"RST 38H", 1, 16, 0, OPND_NONE, 0, 0, FLOW_JUMP} /* FF */
+};
+
+const OpInfo ExtOpInfos[256]={
+	{"RLC B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 00 */
+	{"RLC C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 01 */
+	{"RLC D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 02 */
+	{"RLC E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 03 */
+	{"RLC H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 04 */
+	{"RLC L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 05 */
+	{"RLC (HL)", 2, 16, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 06 */
+	{"RLC A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 07 */
+	{"RRC B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 08 */
+	{"RRC C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 09 */
+	{"RRC D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 0A */
+	{"RRC E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 0B */
+	{"RRC H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 0C */
+	{"RRC L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 0D */
+	{"RRC (HL)", 2, 16, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 0E */
+	{"RRC A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 0F */
+	{"RL B", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 10 */
+	{"RL C", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 11 */
+	{"RL D", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 12 */
+	{"RL E", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 13 */
+	{"RL H", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 14 */
+	{"RL L", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 15 */
+	{"RL (HL)", 2, 16, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 16 */
+	{"RL A", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 17 */
+	{"RR B", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 18 */
+	{"RR C", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 19 */
+	{"RR D", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 1A */
+	{"RR E", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 1B */
+	{"RR H", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 1C */
+	{"RR L", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 1D */
+	{"RR (HL)", 2, 16, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 1E */
+	{"RR A", 2, 8, 0, OPND_NONE, CARRY, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 1F */
+	{"SLA B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 20 */
+	{"SLA C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 21 */
+	{"SLA D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 22 */
+	{"SLA E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 23 */
+	{"SLA H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 24 */
+	{"SLA L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 25 */
+	{"SLA (HL)", 2, 16, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 26 */
+	{"SLA A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 27 */
+	{"SRA B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 28 */
+	{"SRA C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 29 */
+	{"SRA D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 2A */
+	{"SRA E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 2B */
+	{"SRA H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 2C */
+	{"SRA L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 2D */
+	{"SRA (HL)", 2, 16, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 2E */
+	{"SRA A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 2F */
+	{"SWAP B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 30 */
+	{"SWAP C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 31 */
+	{"SWAP D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 32 */
+	{"SWAP E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 33 */
+	{"SWAP H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 34 */
+	{"SWAP L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 35 */
+	{"SWAP (HL)", 2, 16, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 36 */
+	{"SWAP A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 37 */
+	{"SRL B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 38 */
+	{"SRL C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 39 */
+	{"SRL D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 3A */
+	{"SRL E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 3B */
+	{"SRL H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 3C */
+	{"SRL L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 3D */
+	{"SRL (HL)", 2, 16, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 3E */
+	{"SRL A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY|CARRY, FLOW_NONE}, /* 3F */
+	{"BIT 0,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 40 */
+	{"BIT 0,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 41 */
+	{"BIT 0,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 42 */
+	{"BIT 0,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 43 */
+	{"BIT 0,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 44 */
+	{"BIT 0,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 45 */
+	{"BIT 0,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 46 */
+	{"BIT 0,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 47 */
+	{"BIT 1,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 48 */
+	{"BIT 1,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 49 */
+	{"BIT 1,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 4A */
+	{"BIT 1,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 4B */
+	{"BIT 1,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 4C */
+	{"BIT 1,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 4D */
+	{"BIT 1,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 4E */
+	{"BIT 1,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 4F */
+	{"BIT 2,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 50 */
+	{"BIT 2,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 51 */
+	{"BIT 2,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 52 */
+	{"BIT 2,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 53 */
+	{"BIT 2,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 54 */
+	{"BIT 2,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 55 */
+	{"BIT 2,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 56 */
+	{"BIT 2,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 57 */
+	{"BIT 3,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 58 */
+	{"BIT 3,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 59 */
+	{"BIT 3,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 5A */
+	{"BIT 3,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 5B */
+	{"BIT 3,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 5C */
+	{"BIT 3,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 5D */
+	{"BIT 3,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 5E */
+	{"BIT 3,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 5F */
+	{"BIT 4,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 60 */
+	{"BIT 4,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 61 */
+	{"BIT 4,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 62 */
+	{"BIT 4,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 63 */
+	{"BIT 4,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 64 */
+	{"BIT 4,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 65 */
+	{"BIT 4,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 66 */
+	{"BIT 4,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 67 */
+	{"BIT 5,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 68 */
+	{"BIT 5,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 69 */
+	{"BIT 5,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 6A */
+	{"BIT 5,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 6B */
+	{"BIT 5,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 6C */
+	{"BIT 5,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 6D */
+	{"BIT 5,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 6E */
+	{"BIT 5,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 6F */
+	{"BIT 6,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 70 */
+	{"BIT 6,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 71 */
+	{"BIT 6,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 72 */
+	{"BIT 6,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 73 */
+	{"BIT 6,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 74 */
+	{"BIT 6,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 75 */
+	{"BIT 6,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 76 */
+	{"BIT 6,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 77 */
+	{"BIT 7,B", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 78 */
+	{"BIT 7,C", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 79 */
+	{"BIT 7,D", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 7A */
+	{"BIT 7,E", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 7B */
+	{"BIT 7,H", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 7C */
+	{"BIT 7,L", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 7D */
+	{"BIT 7,(HL)", 2, 12, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 7E */
+	{"BIT 7,A", 2, 8, 0, OPND_NONE, 0, ZERO|SUBTRACT|HALFCARRY, FLOW_NONE}, /* 7F */
+	{"RES 0,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 80 */
+	{"RES 0,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 81 */
+	{"RES 0,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 82 */
+	{"RES 0,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 83 */
+	{"RES 0,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 84 */
+	{"RES 0,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 85 */
+	{"RES 0,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 86 */
+	{"RES 0,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 87 */
+	{"RES 1,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 88 */
+	{"RES 1,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 89 */
+	{"RES 1,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 8A */
+	{"RES 1,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 8B */
+	{"RES 1,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 8C */
+	{"RES 1,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 8D */
+	{"RES 1,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 8E */
+	{"RES 1,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 8F */
+	{"RES 2,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 90 */
+	{"RES 2,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 91 */
+	{"RES 2,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 92 */
+	{"RES 2,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 93 */
+	{"RES 2,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 94 */
+	{"RES 2,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 95 */
+	{"RES 2,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 96 */
+	{"RES 2,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 97 */
+	{"RES 3,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 98 */
+	{"RES 3,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 99 */
+	{"RES 3,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 9A */
+	{"RES 3,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 9B */
+	{"RES 3,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 9C */
+	{"RES 3,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 9D */
+	{"RES 3,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 9E */
+	{"RES 3,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* 9F */
+	{"RES 4,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A0 */
+	{"RES 4,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A1 */
+	{"RES 4,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A2 */
+	{"RES 4,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A3 */
+	{"RES 4,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A4 */
+	{"RES 4,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A5 */
+	{"RES 4,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A6 */
+	{"RES 4,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A7 */
+	{"RES 5,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A8 */
+	{"RES 5,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* A9 */
+	{"RES 5,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* AA */
+	{"RES 5,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* AB */
+	{"RES 5,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* AC */
+	{"RES 5,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* AD */
+	{"RES 5,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* AE */
+	{"RES 5,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* AF */
+	{"RES 6,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B0 */
+	{"RES 6,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B1 */
+	{"RES 6,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B2 */
+	{"RES 6,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B3 */
+	{"RES 6,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B4 */
+	{"RES 6,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B5 */
+	{"RES 6,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B6 */
+	{"RES 6,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B7 */
+	{"RES 7,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B8 */
+	{"RES 7,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* B9 */
+	{"RES 7,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* BA */
+	{"RES 7,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* BB */
+	{"RES 7,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* BC */
+	{"RES 7,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* BD */
+	{"RES 7,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* BE */
+	{"RES 7,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* BF */
+	{"SET 0,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C0 */
+	{"SET 0,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C1 */
+	{"SET 0,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C2 */
+	{"SET 0,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C3 */
+	{"SET 0,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C4 */
+	{"SET 0,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C5 */
+	{"SET 0,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C6 */
+	{"SET 0,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C7 */
+	{"SET 1,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C8 */
+	{"SET 1,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* C9 */
+	{"SET 1,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* CA */
+	{"SET 1,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* CB */
+	{"SET 1,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* CC */
+	{"SET 1,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* CD */
+	{"SET 1,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* CE */
+	{"SET 1,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* CF */
+	{"SET 2,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D0 */
+	{"SET 2,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D1 */
+	{"SET 2,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D2 */
+	{"SET 2,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D3 */
+	{"SET 2,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D4 */
+	{"SET 2,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D5 */
+	{"SET 2,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D6 */
+	{"SET 2,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D7 */
+	{"SET 3,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D8 */
+	{"SET 3,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* D9 */
+	{"SET 3,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DA */
+	{"SET 3,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DB */
+	{"SET 3,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DC */
+	{"SET 3,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DD */
+	{"SET 3,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DE */
+	{"SET 3,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* DF */
+	{"SET 4,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E0 */
+	{"SET 4,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E1 */
+	{"SET 4,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E2 */
+	{"SET 4,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E3 */
+	{"SET 4,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E4 */
+	{"SET 4,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E5 */
+	{"SET 4,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E6 */
+	{"SET 4,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E7 */
+	{"SET 5,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E8 */
+	{"SET 5,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* E9 */
+	{"SET 5,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* EA */
+	{"SET 5,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* EB */
+	{"SET 5,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* EC */
+	{"SET 5,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* ED */
+	{"SET 5,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* EE */
+	{"SET 5,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* EF */
+	{"SET 6,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F0 */
+	{"SET 6,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F1 */
+	{"SET 6,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F2 */
+	{"SET 6,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F3 */
+	{"SET 6,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F4 */
+	{"SET 6,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F5 */
+	{"SET 6,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F6 */
+	{"SET 6,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F7 */
+	{"SET 7,B", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F8 */
+	{"SET 7,C", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* F9 */
+	{"SET 7,D", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FA */
+	{"SET 7,E", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FB */
+	{"SET 7,H", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FC */
+	{"SET 7,L", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FD */
+	{"SET 7,(HL)", 2, 16, 0, OPND_NONE, 0, 0, FLOW_NONE}, /* FE */
+	{"SET 7,A", 2, 8, 0, OPND_NONE, 0, 0, FLOW_NONE} /* FF */
+};
+
+void inc(uint8_t* reg, uint8_t* flags)
 {
 	(*reg)++;
 	RESET_N(*flags);
@@ -33,10 +599,9 @@ uint8_t inc(uint8_t* reg, uint8_t* flags)
 	if(!*reg) SET_Z(*flags);
 	else RESET_Z(*flags);
 	*flags &= ~SUBTRACT; /* Reset N flag */
-	return 4;
 }
 
-uint8_t dec(uint8_t* reg, uint8_t* flags)
+void dec(uint8_t* reg, uint8_t* flags)
 {
 	(*reg)--;
 	SET_N(*flags);
@@ -48,38 +613,34 @@ uint8_t dec(uint8_t* reg, uint8_t* flags)
 	}
 	if(!*reg) SET_Z(*flags);
 	else RESET_Z(*flags);
-	return 4;
 }
-uint8_t LDrr_mm(CPU* c, MMU* m, uint8_t* regA, uint8_t* regB)
+void LDrr_mm(CPU* c, MMU* m, uint16_t* rr)
 {
 	/* Immediate values are in little-endian order, */
 	/* so least significant bits are loaded first. */
-	*regB=m[c->PC++];
-	*regA=m[c->PC++];
-	return 12;
+	uint8_t lsb=mmu_read(m, c->PC++);
+	*rr=WORD(mmu_read(m, c->PC++), lsb);
 }
 
-uint8_t ADDrr_rr(CPU* c, uint8_t* ra1, uint8_t* ra2, uint8_t* rb1, uint8_t* rb2)
+void ADDrr_rr(uint16_t* ra, uint16_t rb, uint8_t* flags)
 {
-	c->reg.F &= ~SUBTRACT;
-	uint16_t a1a2 = WORD(*ra1, *ra2);
-	uint16_t result = a1a2 + WORD(*rb1, *rb2);
-	RESET_H(c->reg.F);
-	RESET_C(c->reg.F);
-	if(result < a1a2) c->reg.F |= CARRY|HALFCARRY;
-	else if((result & 0xF000) != (a1a2 & 0xF000))
+	*flags &= ~SUBTRACT;
+	uint16_t result = *ra + rb;
+	RESET_H(*flags);
+	RESET_C(*flags);
+	if(result < *ra) *flags |= CARRY|HALFCARRY;
+	else if((result & 0xF000) != (*ra & 0xF000))
 	{// Carry from bit 11
-		c->reg.F |= HALFCARRY;
+		*flags |= HALFCARRY;
 	}
-	return 8;
 }
 
-uint8_t ADDr_r(CPU* c, uint8_t* reg, uint8_t* reg2)
+void ADDr_r(uint8_t* reg, uint8_t* reg2, uint8_t* flags)
 {
-	RESET_Z(c->reg.F);
-	RESET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	RESET_C(c->reg.F);
+	RESET_Z(*flags);
+	RESET_N(*flags);
+	RESET_H(*flags);
+	RESET_C(*flags);
 
 	uint8_t tmp=*reg;
 	if(*reg2)
@@ -87,32 +648,30 @@ uint8_t ADDr_r(CPU* c, uint8_t* reg, uint8_t* reg2)
 		*reg += *reg2;
 		if(*reg <= tmp)
 		{
-			c->reg.F |= CARRY;
-			c->reg.F |= HALFCARRY;
+			*flags |= CARRY;
+			*flags |= HALFCARRY;
 		}
 		else if((*reg & 0xF0) != (tmp & 0xF0))
 		{
-			c->reg.F |= HALFCARRY;
+			*flags |= HALFCARRY;
 		}
 	}
-	if(!*reg) c->reg.F |= ZERO;
-	return 4;
+	if(!*reg) *flags |= ZERO;
 }
 
-uint8_t ADCr_r(CPU* c, uint8_t* reg, uint8_t* reg2)
+void ADCr_r(uint8_t* reg, uint8_t* reg2, uint8_t* flags)
 {
 	uint8_t val=*reg2;
-	if(c->reg.F & CARRY) val++;
-	ADDr_r(c, reg, &val);
-	return 4;
+	if(*flags & CARRY) val++;
+	ADDr_r(reg, &val, flags);
 }
 
-uint8_t SUBr_r(CPU* c, uint8_t* reg, uint8_t* reg2)
+void SUBr_r(uint8_t* reg, uint8_t* reg2, uint8_t* flags)
 {
-	RESET_Z(c->reg.F);
-	SET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	RESET_C(c->reg.F);
+	RESET_Z(*flags);
+	SET_N(*flags);
+	RESET_H(*flags);
+	RESET_C(*flags);
 
 	uint8_t tmp=*reg;
 	*reg -= *reg2;
@@ -120,146 +679,136 @@ uint8_t SUBr_r(CPU* c, uint8_t* reg, uint8_t* reg2)
 	{
 		if(*reg >= tmp)
 		{
-			c->reg.F |= CARRY;
-			c->reg.F |= HALFCARRY;
+			*flags |= CARRY;
+			*flags |= HALFCARRY;
 		}
 		else if((*reg & 0xF0) != (tmp & 0xF0))
 		{
-			c->reg.F |= HALFCARRY;
+			*flags |= HALFCARRY;
 		}
 	}
-	if(!*reg) c->reg.F |= ZERO;
-	return 4;
+	if(!*reg) *flags |= ZERO;
 }
 
 /* 0 */
 
 void NOP(CPU* c, MMU* m)
 {
-	CYCLES(4);
+	/* Only its cycles, which the dispatch charges */
 }
 
 void LDBCnn(CPU* c, MMU* m)
 {
-	CYCLES(LDrr_mm(c, m, &c->reg.B, &c->reg.C));
+	LDrr_mm(c, m, &c->reg.BC);
 }
 
 void LDBCA(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.B, c->reg.C)]=c->reg.A;
-	CYCLES(8);
+	mmu_write(m, c->reg.BC, c->reg.A);
 }
 
 void INCBC(CPU* c, MMU* m)
 {
-	if(++c->reg.C == 0) c->reg.B++;
-	CYCLES(8);
+	c->reg.BC++;
 }
 
 void INCB(CPU* c, MMU* m)
 {
-	CYCLES(inc(&c->reg.B, &c->reg.F));
+	inc(&c->reg.B, &c->reg.F);
 }
 
 void DECB(CPU* c, MMU* m)
 {
-	CYCLES(dec(&c->reg.B, &c->reg.F));
+	dec(&c->reg.B, &c->reg.F);
 }
 
 void LDBn(CPU* c, MMU* m)
 {
-	c->reg.B=m[c->PC++];
-	CYCLES(8);
+	c->reg.B=mmu_read(m, c->PC++);
 }
 
-int RLCr(CPU* c, MMU* m, uint8_t* reg)
+void RLCr(uint8_t* reg, uint8_t* flags)
 {
 	/* Rotate register left */
-	c->reg.F &= ~CARRY; // Reset carry flag
+	*flags &= ~CARRY; // Reset carry flag
 	if(*reg & 0x80)
 	{
-		c->reg.F |= CARRY; // Contains old bit 7 data
+		*flags |= CARRY; // Contains old bit 7 data
 	}
 	*reg <<= 1;
-	if(c->reg.F & CARRY)
+	if(*flags & CARRY)
 	{
 		*reg |= 0x01;
 	}
-	if(!*reg) c->reg.F |= ZERO;
-	else RESET_Z(c->reg.F);
-	return 4;
+	if(!*reg) *flags |= ZERO;
+	else RESET_Z(*flags);
 }
 
 void RLCA(CPU* c, MMU* m)
 {
-	CYCLES(RLCr(c,m,&c->reg.A));
+	RLCr(&c->reg.A, &c->reg.F);
 }
 
 void LDnnSP(CPU* c, MMU* m)
 {
 	uint8_t lsb;
 	uint8_t msb;
-	lsb=m[c->PC++];
-	msb=m[c->PC++];
+	lsb=mmu_read(m, c->PC++);
+	msb=mmu_read(m, c->PC++);
 	uint16_t imm=WORD(msb,lsb);
-	m[imm]=c->SP;
-	CYCLES(20);
+	mmu_write(m, imm, c->SP);
 }
 
 void ADDHLBC(CPU* c, MMU* m)
 {
-	CYCLES(ADDrr_rr(c, &c->reg.H, &c->reg.L, &c->reg.B, &c->reg.C));
+	ADDrr_rr(&c->reg.HL, c->reg.BC, &c->reg.F);
 }
 
 void LDABC(CPU* c, MMU* m)
 {
-	c->reg.A = m[WORD(c->reg.B, c->reg.C)];
-	CYCLES(8);
+	c->reg.A=mmu_read(m, c->reg.BC);
 }
 
 void DECBC(CPU* c, MMU* m)
 {
-	if(--c->reg.C == 0xFF) c->reg.B--;
-	CYCLES(8);
+	c->reg.BC--;
 }
 
 void INCC(CPU* c, MMU* m)
 {
-	CYCLES(inc(&c->reg.C, &c->reg.F));
+	inc(&c->reg.C, &c->reg.F);
 }
 
 void DECC(CPU* c, MMU* m)
 {
-	CYCLES(dec(&c->reg.C, &c->reg.F));
+	dec(&c->reg.C, &c->reg.F);
 }
 
 void LDCn(CPU* c, MMU* m)
 {
-	c->reg.C=m[c->PC++];
-	CYCLES(8);
+	c->reg.C=mmu_read(m, c->PC++);
 }
 
-int RRCr(CPU* c, MMU* m, uint8_t* reg)
+void RRCr(uint8_t* reg, uint8_t* flags)
 {
 	/* Rotate register right */
-	c->reg.F &= ~CARRY; // Reset carry flag
+	*flags &= ~CARRY; // Reset carry flag
 	if(*reg & 0x00)
 	{
-		c->reg.F |= CARRY; // Contains old bit 0 data
+		*flags |= CARRY; // Contains old bit 0 data
 	}
 	*reg >>= 1;
-	if(c->reg.F & CARRY)
+	if(*flags & CARRY)
 	{
 		*reg |= 0x80;
 	}
-	if(!*reg) c->reg.F |= ZERO;
-	else RESET_Z(c->reg.F);
-	return 4;
+	if(!*reg) *flags |= ZERO;
+	else RESET_Z(*flags);
 }
 
 void RRCA(CPU* c, MMU* m)
 {
-	CYCLES(RRCr(c,m,&c->reg.A));
+	RRCr(&c->reg.A, &c->reg.F);
 }
 
 /* 1 */
@@ -267,128 +816,119 @@ void RRCA(CPU* c, MMU* m)
 void STOP(CPU* c, MMU* m)
 {
 	c->stop=1;
-	CYCLES(4);
+	c->PC++; /* STOP is followed by a padding byte */
 }
 
 void LDDEnn(CPU* c, MMU* m)
 {
-	CYCLES(LDrr_mm(c, m, &c->reg.D, &c->reg.E));
+	LDrr_mm(c, m, &c->reg.DE);
 }
 
 void LDDEA(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.D, c->reg.E)]=c->reg.A;
-	CYCLES(8);
+	mmu_write(m, c->reg.DE, c->reg.A);
 }
 
 void INCDE(CPU* c, MMU* m)
 {
-	if(++c->reg.E == 0) c->reg.D++;
-	CYCLES(8);
+	c->reg.DE++;
 }
 
 void INCD(CPU* c, MMU* m)
 {
-	CYCLES(inc(&c->reg.D, &c->reg.F));
+	inc(&c->reg.D, &c->reg.F);
 }
 
 void DECD(CPU* c, MMU* m)
 {
-	CYCLES(dec(&c->reg.D, &c->reg.F));
+	dec(&c->reg.D, &c->reg.F);
 }
 
 void LDDn(CPU* c, MMU* m)
 {
-	c->reg.D=m[c->PC++];
-	CYCLES(8);
+	c->reg.D=mmu_read(m, c->PC++);
 }
 
-int RLr(CPU* c, MMU* m, uint8_t* reg)
+void RLr(uint8_t* reg, uint8_t* flags)
 {
 	/* Rotate register left through carry flag */
-	uint8_t old_carry = c->reg.F & CARRY;
-	RESET_C(c->reg.F);
+	uint8_t old_carry = *flags & CARRY;
+	RESET_C(*flags);
 	if(*reg & 0x80)
 	{
-		SET_C(c->reg.F); // Contains old bit 7 data
+		SET_C(*flags); // Contains old bit 7 data
 	}
 	*reg <<= 1;
 	if(old_carry)
 	{
 		*reg |= 0x01;
 	}
-	if(!*reg) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 4;
+	if(!*reg) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
 void RLA(CPU* c, MMU* m)
 {
-	CYCLES(RLr(c,m,&c->reg.A));
+	RLr(&c->reg.A, &c->reg.F);
 }
 
 void JRn(CPU* c, MMU* m)
 {
-	int8_t imm=m[c->PC++];
+	int8_t imm=mmu_read(m, c->PC++);
 	c->PC+=imm;
-	CYCLES(8);
 }
 
 void ADDHLDE(CPU* c, MMU* m)
 {
-	CYCLES(ADDrr_rr(c, &c->reg.H, &c->reg.L, &c->reg.D, &c->reg.E));
+	ADDrr_rr(&c->reg.HL, c->reg.DE, &c->reg.F);
 }
 
 void LDADE(CPU* c, MMU* m)
 {
-	c->reg.A = m[WORD(c->reg.D, c->reg.E)];
-	CYCLES(8);
+	c->reg.A=mmu_read(m, c->reg.DE);
 }
 
 void DECDE(CPU* c, MMU* m)
 {
-	if(--c->reg.E == 0xFF) c->reg.D--;
-	CYCLES(8);
+	c->reg.DE--;
 }
 
 void INCE(CPU* c, MMU* m)
 {
-	CYCLES(inc(&c->reg.E, &c->reg.F));
+	inc(&c->reg.E, &c->reg.F);
 }
 
 void DECE(CPU* c, MMU* m)
 {
-	CYCLES(dec(&c->reg.E, &c->reg.F));
+	dec(&c->reg.E, &c->reg.F);
 }
 
 void LDEn(CPU* c, MMU* m)
 {
-	c->reg.E=m[c->PC++];
-	CYCLES(8);
+	c->reg.E=mmu_read(m, c->PC++);
 }
 
-int RRr(CPU* c, MMU*m, uint8_t* reg)
+void RRr(uint8_t* reg, uint8_t* flags)
 {
 	/* Rotate register right through carry flag */
-	uint8_t old_carry = c->reg.F & CARRY;
-	RESET_C(c->reg.F);
+	uint8_t old_carry = *flags & CARRY;
+	RESET_C(*flags);
 	if(*reg & 0x01)
 	{
-		SET_C(c->reg.F); // Contains old bit 0 data
+		SET_C(*flags); // Contains old bit 0 data
 	}
 	*reg >>= 1;
 	if(old_carry)
 	{
 		*reg |= 0x80;
 	}
-	if(!*reg) c->reg.F |= ZERO;
-	else RESET_Z(c->reg.F);
-	return 4;
+	if(!*reg) *flags |= ZERO;
+	else RESET_Z(*flags);
 }
 
 void RRA(CPU* c, MMU* m)
 {
-	CYCLES(RRr(c,m,&c->reg.A));
+	RRr(&c->reg.A, &c->reg.F);
 }
 
 /* 2 */
@@ -397,56 +937,53 @@ void JRNZn(CPU* c, MMU* m)
 {
 	if(!(c->reg.F & ZERO)) /* ZERO flag not set */
 	{
-		JRn(c,m); /* CYCLES(8) */
+		JRn(c,m);
+		TAKEN(0x20);
 	}
-	else CYCLES(8);
+	else c->PC++; /* Skip the offset */
 }
 
 void LDHLnn(CPU* c, MMU* m)
 {
-	CYCLES(LDrr_mm(c, m, &c->reg.H, &c->reg.L));
+	LDrr_mm(c, m, &c->reg.HL);
 }
 
 void LDIHLA(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.A;
-	if(++c->reg.L == 0) c->reg.H++;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL++, c->reg.A);
 }
 
 void INCHL(CPU* c, MMU* m)
 {
-	if(++c->reg.L == 0) c->reg.H++;
-	CYCLES(8);
+	c->reg.HL++;
 }
 
 void INCH(CPU* c, MMU* m)
 {
-	CYCLES(inc(&c->reg.H, &c->reg.F));
+	inc(&c->reg.H, &c->reg.F);
 }
 
 void DECH(CPU* c, MMU* m)
 {
-	CYCLES(dec(&c->reg.H, &c->reg.F));
+	dec(&c->reg.H, &c->reg.F);
 }
 
 void LDHn(CPU* c, MMU* m)
 {
-	c->reg.H=m[c->PC++];
-	CYCLES(8);
+	c->reg.H=mmu_read(m, c->PC++);
 }
 
-void DAA(CPU* c, MMU* m)
+void DAAr(uint8_t* reg, uint8_t* flags)
 {
-	uint8_t h=c->reg.A >> 4;
-	uint8_t l=c->reg.A & 0x0F;
+	uint8_t h=*reg >> 4;
+	uint8_t l=*reg & 0x0F;
 	uint8_t addition=0x0;
 	uint8_t result=0x0;
-	if(c->reg.F & SUBTRACT)
+	if(*flags & SUBTRACT)
 	{// Last instruction was subtraction
-		if(c->reg.F & CARRY)
+		if(*flags & CARRY)
 		{
-			if(c->reg.F & HALFCARRY)
+			if(*flags & HALFCARRY)
 			{
 				if(h >= 0x06 && l >= 0x06)
 				{
@@ -463,7 +1000,7 @@ void DAA(CPU* c, MMU* m)
 		}
 		else
 		{
-			if(c->reg.F & HALFCARRY)
+			if(*flags & HALFCARRY)
 			{
 				if(h <= 0x08 && l >= 0x06)
 				{
@@ -474,9 +1011,9 @@ void DAA(CPU* c, MMU* m)
 	}
 	else
 	{// Last instruction was addition
-		if(c->reg.F & CARRY)
+		if(*flags & CARRY)
 		{
-			if(c->reg.F & HALFCARRY)
+			if(*flags & HALFCARRY)
 			{
 				if(h <= 0x3 && l<= 0x3)
 				{
@@ -500,13 +1037,13 @@ void DAA(CPU* c, MMU* m)
 		}
 		else
 		{
-			if(c->reg.F & HALFCARRY && l<= 0x03)
+			if(*flags & HALFCARRY && l<= 0x03)
 			{
 				if(h <= 0x09) addition=0x06;
 				else if(h >= 0xA)
 				{
 					addition=0x66;
-					c->reg.F |= CARRY;
+					*flags |= CARRY;
 				}
 			}
 			else
@@ -518,64 +1055,67 @@ void DAA(CPU* c, MMU* m)
 				else if(h >= 0x0A && l <= 0x09)
 				{
 					addition=0x60;
-					c->reg.F |= CARRY;
+					*flags |= CARRY;
 				}
 				else if(h >= 0x09 && l >= 0x0A)
 				{
 					addition=0x66;
-					c->reg.F |= CARRY;
+					*flags |= CARRY;
 				}
 			}
 		}
 	}
-	c->reg.F &= ~HALFCARRY;
+	*flags &= ~HALFCARRY;
 	result = ((h << 4)|l)+addition;
-	c->reg.A=result;
-	if(!c->reg.A) c->reg.F |= ZERO;
-	else RESET_Z(c->reg.F);
+	*reg=result;
+	if(!*reg) *flags |= ZERO;
+	else RESET_Z(*flags);
+
+}
 
-	CYCLES(4);
+void DAA(CPU* c, MMU* m)
+{
+	DAAr(&c->reg.A, &c->reg.F);
 }
 
 void JRZn(CPU* c, MMU* m)
 {
 	if((c->reg.F & ZERO)) /* ZERO flag set */
 	{
-		JRn(c,m); /* CYCLES(8) */
+		JRn(c,m);
+		TAKEN(0x28);
 	}
+	else c->PC++; /* Skip the offset */
 }
 
 void ADDHLHL(CPU* c, MMU* m)
 {
-	CYCLES(ADDrr_rr(c, &c->reg.H, &c->reg.L, &c->reg.H, &c->reg.L));
+	ADDrr_rr(&c->reg.HL, c->reg.HL, &c->reg.F);
 }
 
 void LDIAHL(CPU* c, MMU* m)
 {
-	c->reg.A = m[WORD(c->reg.H, c->reg.L)];
-	if(++c->reg.L == 0) c->reg.H++;
-	CYCLES(8);
+	c->reg.A=mmu_read(m, c->reg.HL++);
 }
 
 void DECHL(CPU* c, MMU* m)
 {
-	if(--c->reg.L == 0xFF) c->reg.H--;
+	c->reg.HL--;
 }
 
 void INCL(CPU* c, MMU* m)
 {
-	CYCLES(inc(&c->reg.L, &c->reg.F));
+	inc(&c->reg.L, &c->reg.F);
 }
 
 void DECL(CPU* c, MMU* m)
 {
-	CYCLES(dec(&c->reg.L, &c->reg.F));
+	dec(&c->reg.L, &c->reg.F);
 }
 
 void LDLn(CPU* c, MMU* m)
 {
-	c->reg.L=m[c->PC++];
-	CYCLES(8);
+	c->reg.L=mmu_read(m, c->PC++);
 }
 
 void CPL(CPU* c, MMU* m)
@@ -583,7 +1123,6 @@ void CPL(CPU* c, MMU* m)
 	c->reg.F |= SUBTRACT;
 	c->reg.F |= HALFCARRY;
 	c->reg.A =~ c->reg.A;
-	CYCLES(4);
 }
 
 /* 3 */
@@ -592,47 +1131,46 @@ void JRNCn(CPU* c, MMU* m)
 {
 	if(!(c->reg.F & CARRY)) /* CARRY flag not set */
 	{
-		JRn(c,m); /* CYCLES(8) */
+		JRn(c,m);
+		TAKEN(0x30);
 	}
+	else c->PC++; /* Skip the offset */
 }
 
 void LDSPnn(CPU* c, MMU* m)
 {
-	uint8_t lsb=m[c->PC++];
-	uint8_t msb=m[c->PC++];
+	uint8_t lsb=mmu_read(m, c->PC++);
+	uint8_t msb=mmu_read(m, c->PC++);
 	c->SP = WORD(msb,lsb);
-	CYCLES(12);
 }
 
 void LDDHLA(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.A;
-	if(--c->reg.L == 0xFF) c->reg.H--;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL--, c->reg.A);
 }
 
 void INCSP(CPU* c, MMU* m)
 {
 	c->SP++;
-	CYCLES(8);
 }
 
 void INCHL2(CPU* c, MMU* m)
 {
-	inc(&m[WORD(c->reg.H, c->reg.L)], &c->reg.F);
-	CYCLES(12);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	inc(&n, &c->reg.F);
+	mmu_write(m, c->reg.HL, n);
 }
 
 void DECHL2(CPU* c, MMU* m)
 {
-	dec(&m[WORD(c->reg.H, c->reg.L)], &c->reg.F);
-	CYCLES(12);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	dec(&n, &c->reg.F);
+	mmu_write(m, c->reg.HL, n);
 }
 
 void LDHLn(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)] = m[c->PC++];
-	CYCLES(12);
+	mmu_write(m, c->reg.HL, mmu_read(m, c->PC++));
 }
 
 void SCF(CPU* c, MMU* m)
@@ -640,50 +1178,46 @@ void SCF(CPU* c, MMU* m)
 	c->reg.F &= ~SUBTRACT;
 	c->reg.F &= ~HALFCARRY;
 	c->reg.F |= CARRY;
-	CYCLES(4);
 }
 
 void JRCn(CPU* c, MMU* m)
 {
 	if((c->reg.F & CARRY)) /* CARRY flag set */
 	{
-		JRn(c,m); /* CYCLES(8) */
+		JRn(c,m);
+		TAKEN(0x38);
 	}
+	else c->PC++; /* Skip the offset */
 }
 
 void ADDHLSP(CPU* c, MMU* m)
 {
-	/* SP is given stupidly, but should work */
-	CYCLES(ADDrr_rr(c,&c->reg.H, &c->reg.L, (uint8_t*)&c->SP, (uint8_t*)(&c->SP)+1));
+	ADDrr_rr(&c->reg.HL, c->SP, &c->reg.F);
 }
 
 void LDDAHL(CPU* c, MMU* m)
 {
-	c->reg.A = m[WORD(c->reg.H, c->reg.L)];
-	if(--c->reg.L == 0xFF) c->reg.H--;
-	CYCLES(8);
+	c->reg.A=mmu_read(m, c->reg.HL--);
 }
 
 void DECSP(CPU* c, MMU* m)
 {
 	c->SP--;
-	CYCLES(8);
 }
 
 void INCA(CPU* c, MMU* m)
 {
-	CYCLES(inc(&c->reg.A, &c->reg.F));
+	inc(&c->reg.A, &c->reg.F);
 }
 
 void DECA(CPU* c, MMU* m)
 {
-	CYCLES(dec(&c->reg.A, &c->reg.F));
+	dec(&c->reg.A, &c->reg.F);
 }
 
 void LDAn(CPU* c, MMU* m)
 {
-	c->reg.A=m[c->PC++];
-	CYCLES(8);
+	c->reg.A=mmu_read(m, c->PC++);
 }
 
 void CCF(CPU* c, MMU* m)
@@ -691,7 +1225,6 @@ void CCF(CPU* c, MMU* m)
 	c->reg.F &= ~SUBTRACT;
 	c->reg.F &= ~HALFCARRY;
 	c->reg.F &= ~(c->reg.F & CARRY);
-	CYCLES(4);
 }
 
 /* 4 */
@@ -699,97 +1232,81 @@ void CCF(CPU* c, MMU* m)
 void LDBB(CPU* c, MMU* m)
 {
 	c->reg.B=c->reg.B;
-	CYCLES(4);
 }
 
 void LDBC(CPU* c, MMU* m)
 {
 	c->reg.B=c->reg.C;
-	CYCLES(4);
 }
 
 void LDBD(CPU* c, MMU* m)
 {
 	c->reg.B=c->reg.D;
-	CYCLES(4);
 }
 
 void LDBE(CPU* c, MMU* m)
 {
 	c->reg.B=c->reg.E;
-	CYCLES(4);
 }
 
 void LDBH(CPU* c, MMU* m)
 {
 	c->reg.B=c->reg.H;
-	CYCLES(4);
 }
 
 void LDBL(CPU* c, MMU* m)
 {
 	c->reg.B=c->reg.L;
-	CYCLES(4);
 }
 
 void LDBHL(CPU* c, MMU* m)
 {
-	c->reg.B=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(8);
+	c->reg.B=mmu_read(m, c->reg.HL);
 }
 
 void LDBA(CPU* c, MMU* m)
 {
 	c->reg.B=c->reg.A;
-	CYCLES(4);
 }
 
 void LDCB(CPU* c, MMU* m)
 {
 	c->reg.C=c->reg.B;
-	CYCLES(4);
 }
 
 void LDCC(CPU* c, MMU* m)
 {
 	c->reg.C=c->reg.C;
-	CYCLES(4);
 }
 
 void LDCD(CPU* c, MMU* m)
 {
 	c->reg.C=c->reg.D;
-	CYCLES(4);
 }
 
 void LDCE(CPU* c, MMU* m)
 {
 	c->reg.C=c->reg.E;
-	CYCLES(4);
 }
 
 void LDCH(CPU* c, MMU* m)
 {
 	c->reg.C=c->reg.H;
-	CYCLES(4);
 }
 
 void LDCL(CPU* c, MMU* m)
 {
 	c->reg.C=c->reg.L;
-	CYCLES(4);
 }
 
 void LDCHL(CPU* c, MMU* m)
 {
-	c->reg.C=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(8);
+	c->reg.C=mmu_read(m, c->reg.HL);
 }
 
 void LDCA(CPU* c, MMU* m)
 {
 	c->reg.C=c->reg.A;
-	CYCLES(4);
 }
 
 /* 5 */
@@ -797,97 +1314,81 @@ void LDCA(CPU* c, MMU* m)
 void LDDB(CPU* c, MMU* m)
 {
 	c->reg.D=c->reg.B;
-	CYCLES(4);
 }
 
 void LDDC(CPU* c, MMU* m)
 {
 	c->reg.D=c->reg.C;
-	CYCLES(4);
 }
 
 void LDDD(CPU* c, MMU* m)
 {
 	c->reg.D=c->reg.D;
-	CYCLES(4);
 }
 
 void LDDE(CPU* c, MMU* m)
 {
 	c->reg.D=c->reg.E;
-	CYCLES(4);
 }
 
 void LDDH(CPU* c, MMU* m)
 {
 	c->reg.D=c->reg.H;
-	CYCLES(4);
 }
 
 void LDDL(CPU* c, MMU* m)
 {
 	c->reg.D=c->reg.L;
-	CYCLES(4);
 }
 
 void LDDHL(CPU* c, MMU* m)
 {
-	c->reg.D=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(8);
+	c->reg.D=mmu_read(m, c->reg.HL);
 }
 
 void LDDA(CPU* c, MMU* m)
 {
 	c->reg.D=c->reg.A;
-	CYCLES(4);
 }
 
 void LDEB(CPU* c, MMU* m)
 {
 	c->reg.E=c->reg.B;
-	CYCLES(4);
 }
 
 void LDEC(CPU* c, MMU* m)
 {
 	c->reg.E=c->reg.C;
-	CYCLES(4);
 }
 
 void LDED(CPU* c, MMU* m)
 {
 	c->reg.E=c->reg.D;
-	CYCLES(4);
 }
 
 void LDEE(CPU* c, MMU* m)
 {
 	c->reg.E=c->reg.E;
-	CYCLES(4);
 }
 
 void LDEH(CPU* c, MMU* m)
 {
 	c->reg.E=c->reg.H;
-	CYCLES(4);
 }
 
 void LDEL(CPU* c, MMU* m)
 {
 	c->reg.E=c->reg.L;
-	CYCLES(4);
 }
 
 void LDEHL(CPU* c, MMU* m)
 {
-	c->reg.E=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(8);
+	c->reg.E=mmu_read(m, c->reg.HL);
 }
 
 void LDEA(CPU* c, MMU* m)
 {
 	c->reg.E=c->reg.A;
-	CYCLES(4);
 }
 
 /* 6 */
@@ -895,561 +1396,550 @@ void LDEA(CPU* c, MMU* m)
 void LDHB(CPU* c, MMU* m)
 {
 	c->reg.H=c->reg.B;
-	CYCLES(4);
 }
 
 void LDHC(CPU* c, MMU* m)
 {
 	c->reg.H=c->reg.C;
-	CYCLES(4);
 }
 
 void LDHD(CPU* c, MMU* m)
 {
 	c->reg.H=c->reg.D;
-	CYCLES(4);
 }
 
 void LDHE(CPU* c, MMU* m)
 {
 	c->reg.H=c->reg.E;
-	CYCLES(4);
 }
 
 void LDHH(CPU* c, MMU* m)
 {
 	c->reg.H=c->reg.H;
-	CYCLES(4);
 }
 
 void LDHL(CPU* c, MMU* m)
 {
 	c->reg.H=c->reg.L;
-	CYCLES(4);
 }
 
 void LDHHL(CPU* c, MMU* m)
 {
-	c->reg.H=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(8);
+	c->reg.H=mmu_read(m, c->reg.HL);
 }
 
 void LDHA(CPU* c, MMU* m)
 {
 	c->reg.H=c->reg.A;
-	CYCLES(4);
 }
 
 void LDLB(CPU* c, MMU* m)
 {
 	c->reg.L=c->reg.B;
-	CYCLES(4);
 }
 
 void LDLC(CPU* c, MMU* m)
 {
 	c->reg.L=c->reg.C;
-	CYCLES(4);
 }
 
 void LDLD(CPU* c, MMU* m)
 {
 	c->reg.L=c->reg.D;
-	CYCLES(4);
 }
 
 void LDLE(CPU* c, MMU* m)
 {
 	c->reg.L=c->reg.E;
-	CYCLES(4);
 }
 
 void LDLH(CPU* c, MMU* m)
 {
 	c->reg.L=c->reg.H;
-	CYCLES(4);
 }
 
 void LDLL(CPU* c, MMU* m)
 {
 	c->reg.L=c->reg.L;
-	CYCLES(4);
 }
 
 void LDLHL(CPU* c, MMU* m)
 {
-	c->reg.L=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(8);
+	c->reg.L=mmu_read(m, c->reg.HL);
 }
 
 void LDLA(CPU* c, MMU* m)
 {
 	c->reg.L=c->reg.A;
-	CYCLES(4);
 }
 
 /* 7 */
 
 void LDHLB(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.B;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL, c->reg.B);
 }
 
 void LDHLC(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.C;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL, c->reg.C);
 }
 
 void LDHLD(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.D;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL, c->reg.D);
 }
 
 void LDHLE(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.E;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL, c->reg.E);
 }
 
 void LDHLH(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.H;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL, c->reg.H);
 }
 
 void LDHLL(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.L;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL, c->reg.L);
+}
+
+/*
+ * A halted CPU runs nothing until an event or the end of the run, so the
+ * clock jumps straight to sched.next and the run loops take it from
+ * there. Outside a run nothing bounds the wait, it idles 4 cycles a step.
+ */
+static void halt_skip(CPU* c, MMU* m)
+{
+	uint64_t to=m->sched.next;
+	if(irq_waiting(m))
+	{
+		c->halt=0; /* With IME off HALT just ends */
+		return;
+	}
+	if(to==UINT64_MAX) to=c->c+4;
+	if(to > c->c)
+	{
+		c->halted+=to-c->c;
+		c->c=to;
+	}
 }
 
 void HALT(CPU* c, MMU* m)
 {
+	/* The sleep starts after HALT's own cycles, which the dispatch adds on return */
 	c->halt=1;
-	CYCLES(4);
+	c->c+=OpInfos[0x76].cycles;
+	halt_skip(c,m);
+	c->c-=OpInfos[0x76].cycles;
 }
 
 void LDHLA(CPU* c, MMU* m)
 {
-	m[WORD(c->reg.H, c->reg.L)]=c->reg.A;
-	CYCLES(8);
+	mmu_write(m, c->reg.HL, c->reg.A);
 }
 
 void LDAB(CPU* c, MMU* m)
 {
 	c->reg.A=c->reg.B;
-	CYCLES(4);
 }
 
 void LDAC(CPU* c, MMU* m)
 {
 	c->reg.A=c->reg.C;
-	CYCLES(4);
 }
 
 void LDAD(CPU* c, MMU* m)
 {
 	c->reg.A=c->reg.D;
-	CYCLES(4);
 }
 
 void LDAE(CPU* c, MMU* m)
 {
 	c->reg.A=c->reg.E;
-	CYCLES(4);
 }
 
 void LDAH(CPU* c, MMU* m)
 {
 	c->reg.A=c->reg.H;
-	CYCLES(4);
 }
 
 void LDAL(CPU* c, MMU* m)
 {
 	c->reg.A=c->reg.L;
-	CYCLES(4);
 }
 
 void LDAHL(CPU* c, MMU* m)
 {
-	c->reg.A=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(8);
+	c->reg.A=mmu_read(m, c->reg.HL);
 }
 
 void LDAA(CPU* c, MMU* m)
 {
 	c->reg.A=c->reg.A;
-	CYCLES(4);
 }
 
 /* 8 */
 
 void ADDAB(CPU* c, MMU* m)
 {
-	CYCLES(ADDr_r(c, &c->reg.A, &c->reg.B));
+	ADDr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void ADDAC(CPU* c, MMU* m)
 {
-	CYCLES(ADDr_r(c, &c->reg.A, &c->reg.C));
+	ADDr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void ADDAD(CPU* c, MMU* m)
 {
-	CYCLES(ADDr_r(c, &c->reg.A, &c->reg.D));
+	ADDr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void ADDAE(CPU* c, MMU* m)
 {
-	CYCLES(ADDr_r(c, &c->reg.A, &c->reg.E));
+	ADDr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void ADDAH(CPU* c, MMU* m)
 {
-	CYCLES(ADDr_r(c, &c->reg.A, &c->reg.H));
+	ADDr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void ADDAL(CPU* c, MMU* m)
 {
-	CYCLES(ADDr_r(c, &c->reg.A, &c->reg.L));
+	ADDr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void ADDAHL(CPU* c, MMU* m)
 {
-	ADDr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	ADDr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void ADDAA(CPU* c, MMU* m)
 {
-	CYCLES(ADDr_r(c, &c->reg.A, &c->reg.A));
+	ADDr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
 void ADCAB(CPU* c, MMU* m)
 {
-	CYCLES(ADCr_r(c, &c->reg.A, &c->reg.B));
+	ADCr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void ADCAC(CPU* c, MMU* m)
 {
-	CYCLES(ADCr_r(c, &c->reg.A, &c->reg.C));
+	ADCr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void ADCAD(CPU* c, MMU* m)
 {
-	CYCLES(ADCr_r(c, &c->reg.A, &c->reg.D));
+	ADCr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void ADCAE(CPU* c, MMU* m)
 {
-	CYCLES(ADCr_r(c, &c->reg.A, &c->reg.E));
+	ADCr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void ADCAH(CPU* c, MMU* m)
 {
-	CYCLES(ADCr_r(c, &c->reg.A, &c->reg.H));
+	ADCr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void ADCAL(CPU* c, MMU* m)
 {
-	CYCLES(ADCr_r(c, &c->reg.A, &c->reg.L));
+	ADCr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void ADCAHL(CPU* c, MMU* m)
 {
-	ADCr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	ADCr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void ADCAA(CPU* c, MMU* m)
 {
-	CYCLES(ADCr_r(c, &c->reg.A, &c->reg.A));
+	ADCr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
 /* 9 */
 
 void SUBAB(CPU* c, MMU* m)
 {
-	CYCLES(SUBr_r(c, &c->reg.A, &c->reg.B));
+	SUBr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void SUBAC(CPU* c, MMU* m)
 {
-	CYCLES(SUBr_r(c, &c->reg.A, &c->reg.C));
+	SUBr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void SUBAD(CPU* c, MMU* m)
 {
-	CYCLES(SUBr_r(c, &c->reg.A, &c->reg.D));
+	SUBr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void SUBAE(CPU* c, MMU* m)
 {
-	CYCLES(SUBr_r(c, &c->reg.A, &c->reg.E));
+	SUBr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void SUBAH(CPU* c, MMU* m)
 {
-	CYCLES(SUBr_r(c, &c->reg.A, &c->reg.H));
+	SUBr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void SUBAL(CPU* c, MMU* m)
 {
-	CYCLES(SUBr_r(c, &c->reg.A, &c->reg.L));
+	SUBr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void SUBAHL(CPU* c, MMU* m)
 {
-	SUBr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	SUBr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void SUBAA(CPU* c, MMU* m)
 {
-	CYCLES(SUBr_r(c, &c->reg.A, &c->reg.A));
+	SUBr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
-uint8_t SBCr_r(CPU* c, uint8_t* reg1, uint8_t* reg2)
+void SBCr_r(uint8_t* reg1, uint8_t* reg2, uint8_t* flags)
 {// Subtract n + carry flag from A
-	SET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	RESET_C(c->reg.F);
+	SET_N(*flags);
+	RESET_H(*flags);
+	RESET_C(*flags);
 	if(*reg2)
 	{
 		uint8_t tmp=*reg1;
 		*reg1 -= *reg2;
 		if(CHECK_CARRY_SUB(*reg1, tmp))
 		{
-			SET_H(c->reg.F);
-			SET_C(c->reg.F);
+			SET_H(*flags);
+			SET_C(*flags);
 		}
 		else if(CHECK_HALFCARRY(*reg1, tmp))
 		{
-			SET_H(c->reg.F);
+			SET_H(*flags);
 		}
 	}
-	if(*reg1 == 0x0) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 4;
+	if(*reg1 == 0x0) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
 void SBCAB(CPU* c, MMU* m)
 {
-	CYCLES(SBCr_r(c, &c->reg.A, &c->reg.B));
+	SBCr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void SBCAC(CPU* c, MMU* m)
 {
-	CYCLES(SBCr_r(c, &c->reg.A, &c->reg.C));
+	SBCr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void SBCAD(CPU* c, MMU* m)
 {
-	CYCLES(SBCr_r(c, &c->reg.A, &c->reg.D));
+	SBCr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void SBCAE(CPU* c, MMU* m)
 {
-	CYCLES(SBCr_r(c, &c->reg.A, &c->reg.E));
+	SBCr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void SBCAH(CPU* c, MMU* m)
 {
-	CYCLES(SBCr_r(c, &c->reg.A, &c->reg.H));
+	SBCr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void SBCAL(CPU* c, MMU* m)
 {
-	CYCLES(SBCr_r(c, &c->reg.A, &c->reg.L));
+	SBCr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void SBCAHL(CPU* c, MMU* m)
 {
-	SBCr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	SBCr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void SBCAA(CPU* c, MMU* m)
 {
-	CYCLES(SBCr_r(c, &c->reg.A, &c->reg.A));
+	SBCr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
 /* A */
 
-int ANDr_r(CPU* c, uint8_t* reg1, uint8_t* reg2)
+void ANDr_r(uint8_t* reg1, uint8_t* reg2, uint8_t* flags)
 {
-	RESET_N(c->reg.F);
-	SET_H(c->reg.F);
-	RESET_C(c->reg.F);
+	RESET_N(*flags);
+	SET_H(*flags);
+	RESET_C(*flags);
 
 	*reg1 = *reg1 & *reg2;
 
-	if(*reg1 == 0x0) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
+	if(*reg1 == 0x0) SET_Z(*flags);
+	else RESET_Z(*flags);
 
-	return 4;
 }
 
 void ANDB(CPU* c, MMU* m)
 {
-	CYCLES(ANDr_r(c, &c->reg.A, &c->reg.B));
+	ANDr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void ANDC(CPU* c, MMU* m)
 {
-	CYCLES(ANDr_r(c, &c->reg.A, &c->reg.C));
+	ANDr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void ANDD(CPU* c, MMU* m)
 {
-	CYCLES(ANDr_r(c, &c->reg.A, &c->reg.D));
+	ANDr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void ANDE(CPU* c, MMU* m)
 {
-	CYCLES(ANDr_r(c, &c->reg.A, &c->reg.E));
+	ANDr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void ANDH(CPU* c, MMU* m)
 {
-	CYCLES(ANDr_r(c, &c->reg.A, &c->reg.H));
+	ANDr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void ANDL(CPU* c, MMU* m)
 {
-	CYCLES(ANDr_r(c, &c->reg.A, &c->reg.L));
+	ANDr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void ANDHL(CPU* c, MMU* m)
 {
-	ANDr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	ANDr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void ANDA(CPU* c, MMU* m)
 {
-	CYCLES(ANDr_r(c, &c->reg.A, &c->reg.A));
+	ANDr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
-int XORr_r(CPU* c, uint8_t* reg1, uint8_t* reg2)
+void XORr_r(uint8_t* reg1, uint8_t* reg2, uint8_t* flags)
 {
-	RESET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	RESET_C(c->reg.F);
+	RESET_N(*flags);
+	RESET_H(*flags);
+	RESET_C(*flags);
 
 	*reg1 = *reg1 ^ *reg2;
 
-	if(*reg1 == 0x0) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
+	if(*reg1 == 0x0) SET_Z(*flags);
+	else RESET_Z(*flags);
 
-	return 4;
 }
 
 void XORB(CPU* c, MMU* m)
 {
-	CYCLES(XORr_r(c, &c->reg.A, &c->reg.B));
+	XORr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void XORC(CPU* c, MMU* m)
 {
-	CYCLES(XORr_r(c, &c->reg.A, &c->reg.C));
+	XORr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void XORD(CPU* c, MMU* m)
 {
-	CYCLES(XORr_r(c, &c->reg.A, &c->reg.D));
+	XORr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void XORE(CPU* c, MMU* m)
 {
-	CYCLES(XORr_r(c, &c->reg.A, &c->reg.E));
+	XORr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void XORH(CPU* c, MMU* m)
 {
-	CYCLES(XORr_r(c, &c->reg.A, &c->reg.H));
+	XORr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void XORL(CPU* c, MMU* m)
 {
-	CYCLES(XORr_r(c, &c->reg.A, &c->reg.L));
+	XORr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void XORHL(CPU* c, MMU* m)
 {
-	XORr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	XORr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void XORA(CPU* c, MMU* m)
 {
-	CYCLES(XORr_r(c, &c->reg.A, &c->reg.A));
+	XORr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
 /* B */
 
-int ORr_r(CPU* c, uint8_t* reg1, uint8_t* reg2)
+void ORr_r(uint8_t* reg1, uint8_t* reg2, uint8_t* flags)
 {
-	RESET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	RESET_C(c->reg.F);
+	RESET_N(*flags);
+	RESET_H(*flags);
+	RESET_C(*flags);
 
 	*reg1 = *reg1 | *reg2;
 
-	if(*reg1 == 0x0) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
+	if(*reg1 == 0x0) SET_Z(*flags);
+	else RESET_Z(*flags);
 
-	return 4;
 }
 
 void ORB(CPU* c, MMU* m)
 {
-	CYCLES(ORr_r(c, &c->reg.A, &c->reg.B));
+	ORr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void ORC(CPU* c, MMU* m)
 {
-	CYCLES(ORr_r(c, &c->reg.A, &c->reg.C));
+	ORr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void ORD(CPU* c, MMU* m)
 {
-	CYCLES(ORr_r(c, &c->reg.A, &c->reg.D));
+	ORr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void ORE(CPU* c, MMU* m)
 {
-	CYCLES(ORr_r(c, &c->reg.A, &c->reg.E));
+	ORr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void ORH(CPU* c, MMU* m)
 {
-	CYCLES(ORr_r(c, &c->reg.A, &c->reg.H));
+	ORr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void ORL(CPU* c, MMU* m)
 {
-	CYCLES(ORr_r(c, &c->reg.A, &c->reg.L));
+	ORr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void ORHL(CPU* c, MMU* m)
 {
-	ORr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	ORr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void ORA(CPU* c, MMU* m)
 {
-	CYCLES(ORr_r(c, &c->reg.A, &c->reg.A));
+	ORr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
-int CPr_r(CPU* c, uint8_t* reg1, uint8_t* reg2)
+void CPr_r(uint8_t* reg1, uint8_t* reg2, uint8_t* flags)
 {
-	SET_N(c->reg.F);
+	SET_N(*flags);
 	uint8_t tmp=*reg1;
 	uint8_t tmp2=*reg1;
 	tmp -= *reg2;
@@ -1457,128 +1947,146 @@ int CPr_r(CPU* c, uint8_t* reg1, uint8_t* reg2)
 	{
 		if(tmp >= tmp2)
 		{
-			SET_C(c->reg.F); // ?
-			SET_H(c->reg.F);
+			SET_C(*flags); // ?
+			SET_H(*flags);
 		}
 		else if((tmp & 0xF0) != (tmp2 & 0xF0))
 		{
-			SET_H(c->reg.F);
+			SET_H(*flags);
 		}
 	}
-	if(*reg1 < *reg2) SET_C(c->reg.F);
-	else RESET_C(c->reg.F);
-	if(*reg1 == *reg2) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 4;
+	if(*reg1 < *reg2) SET_C(*flags);
+	else RESET_C(*flags);
+	if(*reg1 == *reg2) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
 void CPB(CPU* c, MMU* m)
 {
-	CYCLES(CPr_r(c, &c->reg.A, &c->reg.B));
+	CPr_r(&c->reg.A, &c->reg.B, &c->reg.F);
 }
 
 void CPC(CPU* c, MMU* m)
 {
-	CYCLES(CPr_r(c, &c->reg.A, &c->reg.C));
+	CPr_r(&c->reg.A, &c->reg.C, &c->reg.F);
 }
 
 void CPD(CPU* c, MMU* m)
 {
-	CYCLES(CPr_r(c, &c->reg.A, &c->reg.D));
+	CPr_r(&c->reg.A, &c->reg.D, &c->reg.F);
 }
 
 void CPE(CPU* c, MMU* m)
 {
-	CYCLES(CPr_r(c, &c->reg.A, &c->reg.E));
+	CPr_r(&c->reg.A, &c->reg.E, &c->reg.F);
 }
 
 void CPH(CPU* c, MMU* m)
 {
-	CYCLES(CPr_r(c, &c->reg.A, &c->reg.H));
+	CPr_r(&c->reg.A, &c->reg.H, &c->reg.F);
 }
 
 void CP_L(CPU* c, MMU* m)
 {
-	CYCLES(CPr_r(c, &c->reg.A, &c->reg.L));
+	CPr_r(&c->reg.A, &c->reg.L, &c->reg.F);
 }
 
 void CPHL(CPU* c, MMU* m)
 {
-	CPr_r(c, &c->reg.A, &m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->reg.HL);
+	CPr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void CPA(CPU* c, MMU* m)
 {
-	CYCLES(CPr_r(c, &c->reg.A, &c->reg.A));
+	CPr_r(&c->reg.A, &c->reg.A, &c->reg.F);
 }
 
 /* C */
 
 void RETNZ(CPU* c, MMU* m)
 {
-	if(!(c->reg.F & ZERO)) RET(c,m);
-	else CYCLES(8);
+	if(!(c->reg.F & ZERO))
+	{
+		RET(c,m);
+		TAKEN(0xC0);
+	}
 }
 
-void POPr_r(CPU* c, MMU* m, uint8_t* reg1, uint8_t* reg2)
+void POPr_r(CPU* c, MMU* m, uint16_t* rr)
 {
-	*reg2=m[c->SP++];
-	*reg1=m[c->SP++];
-	CYCLES(12);
+	uint8_t lsb=mmu_read(m, c->SP++);
+	*rr=WORD(mmu_read(m, c->SP++), lsb);
 }
 
 void POPBC(CPU* c, MMU* m)
 {
-	POPr_r(c,m,&c->reg.B,&c->reg.C);
+	POPr_r(c,m,&c->reg.BC);
 }
 
 void JPNZnn(CPU* c, MMU* m)
 {
-	if((c->reg.F & ZERO) == 0x0) JPnn(c,m);
-	else CYCLES(12);
+	if((c->reg.F & ZERO) == 0x0)
+	{
+		JPnn(c,m);
+		TAKEN(0xC2);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
 void JPnn(CPU* c, MMU* m)
 {
 	uint16_t addr=0;
-	uint8_t lsb=m[c->PC++];
-	uint8_t msb=m[c->PC++];
+	uint8_t lsb=mmu_read(m, c->PC++);
+	uint8_t msb=mmu_read(m, c->PC++);
 	addr=WORD(msb, lsb);
 	c->PC=addr;
-	CYCLES(12);
 }
 
 void CALLNZnn(CPU* c, MMU* m)
 {
-	if((c->reg.F & ZERO) == 0x0) CALLnn(c,m);
-	else CYCLES(12);
+	if((c->reg.F & ZERO) == 0x0)
+	{
+		CALLnn(c,m);
+		TAKEN(0xC4);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
-void PUSHr_r(CPU* c, MMU* m, uint8_t* reg1, uint8_t* reg2)
+void PUSHr_r(CPU* c, MMU* m, uint16_t rr)
 {
-	m[--c->SP]=*reg1;
-	m[--c->SP]=*reg2;
-	CYCLES(16);
+	mmu_write(m, --c->SP, rr>>8);
+	mmu_write(m, --c->SP, rr & 0xFF);
 }
 
 void PUSHBC(CPU* c, MMU* m)
 {
-	PUSHr_r(c,m,&c->reg.B,&c->reg.C);
+	PUSHr_r(c,m,c->reg.BC);
 }
 
 void ADDAn(CPU* c, MMU* m)
 {
-	ADDr_r(c, &c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	ADDr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST(CPU* c, MMU* m, uint8_t val)
 {
-	m[--c->SP]=c->PC&0xF;
-	m[--c->SP]=c->PC>>8;
+	mmu_write(m, --c->SP, c->PC>>8);
+	mmu_write(m, --c->SP, c->PC&0xFF);
 	c->PC=val;
-	CYCLES(32);
+}
+
+/* Calls the handler of the interrupt that is due, like CALL but in 20 cycles */
+static void interrupt(CPU* c, MMU* m)
+{
+	uint16_t vector=irq_take(m);
+	c->halt=0;
+	c->SP-=2;
+	mmu_write(m, c->SP+1, c->PC>>8);
+	mmu_write(m, c->SP, c->PC&0xFF);
+	c->PC=vector;
+	CYCLES(20);
 }
 
 void RST0(CPU* c, MMU* m)
@@ -1588,50 +2096,65 @@ void RST0(CPU* c, MMU* m)
 
 void RETZ(CPU* c, MMU* m)
 {
-	if(c->reg.F & ZERO) RET(c,m);
-	else CYCLES(8);
+	if(c->reg.F & ZERO)
+	{
+		RET(c,m);
+		TAKEN(0xC8);
+	}
 }
 
 void RET(CPU* c, MMU* m)
 {// Pop two bytes from stack & jump to that address
-	uint8_t lsb=m[c->SP++];
-	uint8_t msb=m[c->SP++];
+	uint8_t lsb=mmu_read(m, c->SP++);
+	uint8_t msb=mmu_read(m, c->SP++);
 	c->PC=WORD(msb, lsb);
-	CYCLES(8);
 }
 
 void JPZnn(CPU* c, MMU* m)
 {
-	if(c->reg.F & ZERO) JPnn(c,m);
-	else CYCLES(12);
+	if(c->reg.F & ZERO)
+	{
+		JPnn(c,m);
+		TAKEN(0xCA);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
 void Extops(CPU* c, MMU* m)
 {
-	ExtOps[m[c->PC++]](c,m);
+	uint8_t op=mmu_read(m, c->PC++);
+#ifdef CB_DECODE
+	CBdecode(c,m,op);
+#else
+	ExtOps[op](c,m);
+#endif
+	CYCLES(ExtOpInfos[op].cycles); /* The prefix itself costs nothing in OpInfos */
 }
 
 void CALLZnn(CPU* c, MMU* m)
 {
-	if(c->reg.F & ZERO) CALLnn(c,m);
-	else CYCLES(12);
+	if(c->reg.F & ZERO)
+	{
+		CALLnn(c,m);
+		TAKEN(0xCC);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
 void CALLnn(CPU* c, MMU* m)
 {
 	c->SP-=2;
-	uint8_t lsb=m[c->PC++];
-	uint8_t msb=m[c->PC++];
-	m[c->SP+1]=c->PC>>8;
-	m[c->SP]=c->PC&0xFF;
+	uint8_t lsb=mmu_read(m, c->PC++);
+	uint8_t msb=mmu_read(m, c->PC++);
+	mmu_write(m, c->SP+1, c->PC>>8);
+	mmu_write(m, c->SP, c->PC&0xFF);
 	c->PC=WORD(msb, lsb);
-	CYCLES(12);
 }
 
 void ADCAn(CPU* c, MMU* m)
 {
-	ADCr_r(c, &c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	ADCr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST8(CPU* c, MMU* m)
@@ -1643,36 +2166,47 @@ void RST8(CPU* c, MMU* m)
 
 void RETNC(CPU* c, MMU* m)
 {
-	if(!(c->reg.F & CARRY)) RET(c,m);
-	else CYCLES(8);
+	if(!(c->reg.F & CARRY))
+	{
+		RET(c,m);
+		TAKEN(0xD0);
+	}
 }
 
 void POPDE(CPU* c, MMU* m)
 {
-	POPr_r(c,m,&c->reg.D,&c->reg.E);
+	POPr_r(c,m,&c->reg.DE);
 }
 
 void JPNCnn(CPU* c, MMU* m)
 {
-	if((c->reg.F & CARRY) == 0x0) JPnn(c,m);
-	else CYCLES(12);
+	if((c->reg.F & CARRY) == 0x0)
+	{
+		JPnn(c,m);
+		TAKEN(0xD2);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
 void CALLNCnn(CPU* c, MMU* m)
 {
-	if((c->reg.F & CARRY) == 0x0) CALLnn(c,m);
-	else CYCLES(12);
+	if((c->reg.F & CARRY) == 0x0)
+	{
+		CALLnn(c,m);
+		TAKEN(0xD4);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
 void PUSHDE(CPU* c, MMU* m)
 {
-	PUSHr_r(c,m,&c->reg.D,&c->reg.E);
+	PUSHr_r(c,m,c->reg.DE);
 }
 
 void SUBAn(CPU* c, MMU* m)
 {
-	SUBr_r(c,&c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	SUBr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST10(CPU* c, MMU* m)
@@ -1682,32 +2216,44 @@ void RST10(CPU* c, MMU* m)
 
 void RETC(CPU* c, MMU* m)
 {
-	if(c->reg.F & CARRY) RET(c,m);
-	else CYCLES(8);
+	if(c->reg.F & CARRY)
+	{
+		RET(c,m);
+		TAKEN(0xD8);
+	}
 }
 
 void RETI(CPU* c, MMU* m)
 {
 	RET(c,m);
-	// TODO: Enable interrupts
+	c->ime=1; /* At once, unlike EI */
+	irq_update(m);
 }
 
 void JPCnn(CPU* c, MMU* m)
 {
-	if(c->reg.F & CARRY) JPnn(c,m);
-	else CYCLES(12);
+	if(c->reg.F & CARRY)
+	{
+		JPnn(c,m);
+		TAKEN(0xDA);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
 void CALLCnn(CPU* c, MMU* m)
 {
-	if(c->reg.F & CARRY) CALLnn(c,m);
-	else CYCLES(12);
+	if(c->reg.F & CARRY)
+	{
+		CALLnn(c,m);
+		TAKEN(0xDC);
+	}
+	else c->PC+=2; /* Skip the address */
 }
 
 void SBCAn(CPU* c, MMU* m)
 {
-	SBCr_r(c, &c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	SBCr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST18(CPU* c, MMU* m)
@@ -1719,30 +2265,28 @@ void RST18(CPU* c, MMU* m)
 
 void LDHnA(CPU* c, MMU* m)
 {
-	m[0xFF00 + m[c->PC++]]=c->reg.A;
-	CYCLES(12);
+	mmu_write(m, 0xFF00 + mmu_read(m, c->PC++), c->reg.A);
 }
 
 void POPHL(CPU* c, MMU* m)
 {
-	POPr_r(c,m,&c->reg.H,&c->reg.L);
+	POPr_r(c,m,&c->reg.HL);
 }
 
 void LDHCA(CPU* c, MMU* m)
 {
-	m[0xFF00 + c->reg.C]=c->reg.A;
-	CYCLES(8);
+	mmu_write(m, 0xFF00 + c->reg.C, c->reg.A);
 }
 
 void PUSHHL(CPU* c, MMU* m)
 {
-	PUSHr_r(c,m,&c->reg.H,&c->reg.L);
+	PUSHr_r(c,m,c->reg.HL);
 }
 
 void ANDn(CPU* c, MMU* m)
 {
-	ANDr_r(c, &c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	ANDr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST20(CPU* c, MMU* m)
@@ -1754,31 +2298,28 @@ void ADDSPd(CPU* c, MMU* m)
 {
 	RESET_Z(c->reg.F);
 	RESET_N(c->reg.F);
-	int8_t imm=m[c->PC++];
+	int8_t imm=mmu_read(m, c->PC++);
 	c->SP+=imm;
 	// H and C flags according to operation???
-	CYCLES(16);
 }
 
 void JPHL(CPU* c, MMU* m)
 {
-	c->PC=m[WORD(c->reg.H, c->reg.L)];
-	CYCLES(4);
+	c->PC=c->reg.HL;
 }
 
 void LDnnA(CPU* c, MMU* m)
 {
-	uint8_t lsb=m[c->PC++];
-	uint8_t msb=m[c->PC++];
+	uint8_t lsb=mmu_read(m, c->PC++);
+	uint8_t msb=mmu_read(m, c->PC++);
 	uint16_t imm=WORD(msb,lsb);
-	m[imm]=c->reg.A;
-	CYCLES(16);
+	mmu_write(m, imm, c->reg.A);
 }
 
 void XORn(CPU* c, MMU* m)
 {
-	XORr_r(c, &c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	XORr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST28(CPU* c, MMU* m)
@@ -1790,29 +2331,30 @@ void RST28(CPU* c, MMU* m)
 
 void LDHAn(CPU* c, MMU* m)
 {
-	c->reg.A=m[0xFF00 + m[c->PC++]];
-	CYCLES(12);
+	c->reg.A=mmu_read(m, 0xFF00 + mmu_read(m, c->PC++));
 }
 
 void POPAF(CPU* c, MMU* m)
 {
-	POPr_r(c,m,&c->reg.A,&c->reg.F);
+	POPr_r(c,m,&c->reg.AF);
 }
 
 void DI(CPU* c, MMU* m)
 {
-	/* Disable interrupts */
+	c->ime=0;
+	sched_cancel(m, EV_EI); /* An EI right before does not get to enable them */
+	irq_update(m);
 }
 
 void PUSHAF(CPU* c, MMU* m)
 {
-	PUSHr_r(c,m,&c->reg.A,&c->reg.F);
+	PUSHr_r(c,m,c->reg.AF);
 }
 
 void ORn(CPU* c, MMU* m)
 {
-	ORr_r(c, &c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	ORr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST30(CPU* c, MMU* m)
@@ -1825,38 +2367,36 @@ void LDHLSPd(CPU* c, MMU* m)
 	// TODO: Check endianess
 	RESET_Z(c->reg.F);
 	RESET_N(c->reg.F);
-	int8_t imm=m[c->PC++];
+	int8_t imm=mmu_read(m, c->PC++);
 	uint16_t val=c->SP+imm;
 	c->reg.H=val>>8;
 	c->reg.L=val&0x00FF;
 	// H and C flags according to operation???
-	CYCLES(12);
 }
 
 void LDSPHL(CPU* c, MMU* m)
 {
-	c->SP=WORD(c->reg.H, c->reg.L);
-	CYCLES(8);
+	c->SP=c->reg.HL;
 }
 
 void LDAnn(CPU* c, MMU* m)
 {
-	uint8_t lsb=m[c->PC++];
-	uint8_t msb=m[c->PC++];
+	uint8_t lsb=mmu_read(m, c->PC++);
+	uint8_t msb=mmu_read(m, c->PC++);
 	uint16_t imm=WORD(msb, lsb);
-	c->reg.A=m[imm];
-	CYCLES(16);
+	c->reg.A=mmu_read(m, imm);
 }
 
 void EI(CPU* c, MMU* m)
 {
-	/* Enable interrupts */
+	/* Due inside the next instruction, so it fires at the boundary after it */
+	if(!c->ime) sched_add(m, EV_EI, c->c+OpInfos[0xFB].cycles+1);
 }
 
 void CPn(CPU* c, MMU* m)
 {
-	CPr_r(c, &c->reg.A, &m[c->PC++]);
-	CYCLES(8);
+	uint8_t n=mmu_read(m, c->PC++);
+	CPr_r(&c->reg.A, &n, &c->reg.F);
 }
 
 void RST38(CPU* c, MMU* m)
@@ -1864,1506 +2404,1488 @@ void RST38(CPU* c, MMU* m)
 	RST(c,m,0x38);
 }
 
-void RLCB(CPU* c, MMU* m)
+void SLAr(uint8_t* reg, uint8_t* flags)
 {
-	RLCr(c,m,&c->reg.B);
-	CYCLES(8);
-}
-
-void RLCC(CPU* c, MMU* m)
-{
-	RLCr(c,m,&c->reg.C);
-	CYCLES(8);
+	RESET_N(*flags);
+	RESET_H(*flags);
+	if(*reg&0x80) SET_C(*flags);
+	else RESET_C(*flags);
+	*reg <<= 1;
+	if(!*reg) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
-void RLCD(CPU* c, MMU* m)
+void SRAr(uint8_t* reg, uint8_t* flags)
 {
-	RLCr(c,m,&c->reg.D);
-	CYCLES(8);
+	RESET_N(*flags);
+	RESET_H(*flags);
+	uint8_t msb=0;
+	if(*reg&0x80) msb=0x80;
+	if(*reg&0x01) SET_C(*flags);
+	else RESET_C(*flags);
+	*reg >>= 1;
+	*reg |= msb;
+	if(!*reg) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
-void RLCE(CPU* c, MMU* m)
+void SWAPr(uint8_t* reg, uint8_t* flags)
 {
-	RLCr(c,m,&c->reg.E);
-	CYCLES(8);
+	RESET_N(*flags);
+	RESET_H(*flags);
+	RESET_C(*flags);
+	uint8_t uptmp=(*reg)>>4;
+	*reg <<= 4;
+	*reg |= uptmp;
+	if(!*reg) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
-void RLCH(CPU* c, MMU* m)
+void SRLr(uint8_t* reg, uint8_t* flags)
 {
-	RLCr(c,m,&c->reg.H);
-	CYCLES(8);
+	RESET_N(*flags);
+	RESET_H(*flags);
+	if(*reg&0x01) SET_C(*flags);
+	else RESET_C(*flags);
+	*reg >>= 1;
+	if(!*reg) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
-void RLCL(CPU* c, MMU* m)
+void BITr(uint8_t b, uint8_t* reg, uint8_t* flags)
 {
-	RLCr(c,m,&c->reg.L);
-	CYCLES(8);
+	RESET_N(*flags);
+	SET_H(*flags);
+	if(((*reg >> b) & 0x1) == 0) SET_Z(*flags);
+	else RESET_Z(*flags);
 }
 
-void RLCHL(CPU* c, MMU* m)
+void RESr(uint8_t b, uint8_t* reg)
 {
-	RLCr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
+	assert(b<=7);
+	switch(b)
+	{
+		case 0: *reg&=0xFE;break;
+		case 1: *reg&=0xFD;break;
+		case 2: *reg&=0xFB;break;
+		case 3: *reg&=0xF7;break;
+		case 4: *reg&=0xEF;break;
+		case 5: *reg&=0xDF;break;
+		case 6: *reg&=0xBF;break;
+		case 7: *reg&=0x7F;break;
+	}
 }
 
-void RLCAext(CPU* c, MMU* m)
+void SETr(uint8_t b, uint8_t* reg)
 {
-	RLCA(c,m);
-	CYCLES(8);
+	assert(b<=7);
+	switch(b)
+	{
+		case 0: *reg|=0x01;break;
+		case 1: *reg|=0x02;break;
+		case 2: *reg|=0x04;break;
+		case 3: *reg|=0x08;break;
+		case 4: *reg|=0x10;break;
+		case 5: *reg|=0x20;break;
+		case 6: *reg|=0x40;break;
+		case 7: *reg|=0x80;break;
+	}
 }
 
-void RRCB(CPU* c, MMU* m)
+/*
+ * CB page handlers. Bits 7-6 of the opcode pick the group, bits 5-3 the
+ * rotate/shift kind or the bit number and bits 2-0 the register, where 6
+ * is (HL). CB_ROW stamps out one row of eight specialized handlers, BIT
+ * only reads (HL) while the others write it back. Extops charges their
+ * cycles from ExtOpInfos.
+ */
+#define CB_OP(name, reg, expr) void name(CPU* c, MMU* m) { uint8_t* r=reg; expr; }
+#define CB_HL_READ(name, expr) void name(CPU* c, MMU* m) { \
+	uint8_t v=mmu_read(m, c->reg.HL), *r=&v; expr; }
+#define CB_HL_RMW(name, expr) void name(CPU* c, MMU* m) { \
+	uint8_t v=mmu_read(m, c->reg.HL), *r=&v; expr; mmu_write(m, c->reg.HL, v); }
+#define CB_ROW(name, a_name, hl, expr) \
+	CB_OP(name##B, &c->reg.B, expr) \
+	CB_OP(name##C, &c->reg.C, expr) \
+	CB_OP(name##D, &c->reg.D, expr) \
+	CB_OP(name##E, &c->reg.E, expr) \
+	CB_OP(name##H, &c->reg.H, expr) \
+	CB_OP(name##L, &c->reg.L, expr) \
+	hl(name##HL, expr) \
+	CB_OP(a_name, &c->reg.A, expr)
+#define CB_BIT_ROWS(b) \
+	CB_ROW(BIT##b, BIT##b##A, CB_HL_READ, BITr(b, r, &c->reg.F)) \
+	CB_ROW(RES##b, RES##b##A, CB_HL_RMW, RESr(b, r)) \
+	CB_ROW(SET##b, SET##b##A, CB_HL_RMW, SETr(b, r))
+
+CB_ROW(RLC, RLCAext, CB_HL_RMW, RLCr(r, &c->reg.F))
+CB_ROW(RRC, RRCAext, CB_HL_RMW, RRCr(r, &c->reg.F))
+CB_ROW(RL, RLAext, CB_HL_RMW, RLr(r, &c->reg.F))
+CB_ROW(RR, RRAext, CB_HL_RMW, RRr(r, &c->reg.F))
+CB_ROW(SLA, SLAA, CB_HL_RMW, SLAr(r, &c->reg.F))
+CB_ROW(SRA, SRAA, CB_HL_RMW, SRAr(r, &c->reg.F))
+CB_ROW(SWAP, SWAPA, CB_HL_RMW, SWAPr(r, &c->reg.F))
+CB_ROW(SRL, SRLA, CB_HL_RMW, SRLr(r, &c->reg.F))
+CB_BIT_ROWS(0)
+CB_BIT_ROWS(1)
+CB_BIT_ROWS(2)
+CB_BIT_ROWS(3)
+CB_BIT_ROWS(4)
+CB_BIT_ROWS(5)
+CB_BIT_ROWS(6)
+CB_BIT_ROWS(7)
+
+#ifdef CB_DECODE
+/* The same page decoded at runtime in one function, see Extops */
+void CBdecode(CPU* c, MMU* m, uint8_t op)
+{
+	uint8_t b=(op>>3)&7;
+	uint8_t v, *r;
+	switch(op&7)
+	{
+		case 0: r=&c->reg.B; break;
+		case 1: r=&c->reg.C; break;
+		case 2: r=&c->reg.D; break;
+		case 3: r=&c->reg.E; break;
+		case 4: r=&c->reg.H; break;
+		case 5: r=&c->reg.L; break;
+		case 6: v=mmu_read(m, c->reg.HL); r=&v; break;
+		default: r=&c->reg.A; break;
+	}
+	switch(op>>6)
+	{
+		case 0:
+			switch(b)
+			{
+				case 0: RLCr(r, &c->reg.F); break;
+				case 1: RRCr(r, &c->reg.F); break;
+				case 2: RLr(r, &c->reg.F); break;
+				case 3: RRr(r, &c->reg.F); break;
+				case 4: SLAr(r, &c->reg.F); break;
+				case 5: SRAr(r, &c->reg.F); break;
+				case 6: SWAPr(r, &c->reg.F); break;
+				default: SRLr(r, &c->reg.F); break;
+			}
+			break;
+		case 1: BITr(b, r, &c->reg.F); break;
+		case 2: RESr(b, r); break;
+		default: SETr(b, r); break;
+	}
+	if((op&7)==6 && (op>>6)!=1) mmu_write(m, c->reg.HL, v);
+}
+#endif
+
+#if defined(ALU_TABLES) || defined(JIT)
+/*
+ * ALU lookup tables, used by -DALU_TABLES on top of THREADED_DISPATCH and
+ * by the JIT. They are filled once by running the helpers above over
+ * every input, so both get the exact same results without their branches.
+ * Entries hold the result in the high byte and the Z, N, H and C bits in
+ * the low byte.
+ */
+uint16_t AluAdd[256*256]; /* [A<<8|n], ADC adds the carry to n */
+uint16_t AluSub[256*256];
+uint16_t AluSbc[256*256];
+uint8_t AluCp[256*256]; /* Flags only, CP never clears H */
+uint8_t AluInc[256]; /* Flags of INC/DEC on the old value, C is kept */
+uint8_t AluDec[256];
+uint16_t AluDaa[256*8]; /* [A<<3|N<<2|H<<1|C] */
+static int AluReady=0;
+
+void alu_tables_init(void)
 {
-	RRCr(c,m,&c->reg.B);
-	CYCLES(8);
-}
-
-void RRCC(CPU* c, MMU* m)
+	int i;
+	if(AluReady) return;
+	for(i=0; i<256*256; ++i)
+	{
+		uint8_t x, y=i&0xFF, f;
+		x=i>>8; f=0; ADDr_r(&x, &y, &f); AluAdd[i]=x<<8|f;
+		x=i>>8; f=0; SUBr_r(&x, &y, &f); AluSub[i]=x<<8|f;
+		x=i>>8; f=0; SBCr_r(&x, &y, &f); AluSbc[i]=x<<8|f;
+		x=i>>8; f=0; CPr_r(&x, &y, &f); AluCp[i]=f;
+	}
+	for(i=0; i<256; ++i)
+	{
+		uint8_t x, f;
+		x=i; f=0; inc(&x, &f); AluInc[i]=f;
+		x=i; f=0; dec(&x, &f); AluDec[i]=f;
+	}
+	for(i=0; i<256*8; ++i)
+	{
+		uint8_t x=i>>3, f=(i&7)<<4;
+		DAAr(&x, &f);
+		AluDaa[i]=x<<8|f;
+	}
+	AluReady=1;
+}
+#endif
+
+#ifdef THREADED_DISPATCH
+/*
+ * Threaded interpreter core, selected with -DTHREADED_DISPATCH (needs the
+ * GCC/Clang labels-as-values extension).
+ *
+ * Instead of returning to execute_next and calling through OpCodes[] for
+ * every instruction, each handler jumps straight to the next one through a
+ * label table, so every opcode gets its own indirect branch. The register
+ * file lives in locals for the whole run and is only written back to the
+ * CPU on exit. Opcodes that are too rare to matter are spilled back to the
+ * CPU and run through OpCodes[], which keeps both cores in lockstep.
+ *
+ * Handlers fetch immediates with T_IMM8/T_IMM16, load with T_READ and
+ * store through T_WRITE so that the same bodies run from the block cache
+ * below.
+ */
+
+#ifdef BLOCK_CACHE
+/*
+ * Predecoded block cache, selected with -DBLOCK_CACHE on top of
+ * THREADED_DISPATCH. Straight-line code is decoded once into micro-ops that
+ * hold the handler label and the already assembled immediate, so hot loops
+ * never touch their opcode bytes again. A bitmap of the bytes covered by
+ * cached blocks lets a store invalidate only when it actually hits code.
+ * Blocks stay within one page and remember where it pointed, so code
+ * under a switched bank is decoded again instead of run stale.
+ *
+ * The pairs in Fusions[] are decoded into a single micro-op that runs both
+ * instructions. Build with -DFUSION_STATS to count how often each fired.
+ */
+#define BLOCK_SLOTS 1024 /* Direct mapped on the low bits of PC */
+#define BLOCK_MAX 16 /* Micro-ops per block */
+#define BLOCK_INVALID 0x10000
+
+#define FUSE_DECB_JRNZ 0
+#define FUSE_LDIAHL_LDDEA 1
+#define FUSE_LDHAN_CPN 2
+#define FUSE_COUNT 3
+
+static const struct Fusion
+{
+	uint8_t first;
+	uint8_t second;
+	const char* name;
+} Fusions[FUSE_COUNT]={
+	{0x05, 0x20, "DEC B; JR NZ,n"}, /* Counted loops */
+	{0x2A, 0x12, "LD A,(HL+); LD (DE),A"}, /* Copy loops */
+	{0xF0, 0xFE, "LDH A,(n); CP n"} /* Register polling */
+};
+
+typedef struct MicroOp
+{
+	void* op; /* Handler label in run_threaded */
+	uint32_t pc; /* Address of the instruction, BLOCK_INVALID ends the block */
+	uint16_t next; /* PC as the handler expects it, past its operands */
+	uint16_t imm; /* Immediate operand */
+} UOp;
+
+typedef struct DecodedBlock
+{
+	uint32_t pc;
+	uint16_t len; /* Bytes of code covered */
+	const uint8_t* base; /* Page the block was decoded from, a bank switch repoints it */
+	UOp ops[BLOCK_MAX+1];
+} Block;
+
+struct BlockCache
+{
+	Block slot[BLOCK_SLOTS];
+	UOp stop[2]; /* Dispatching past stop[0] forces a lookup */
+	uint8_t code[65536/8]; /* Bytes covered by cached blocks */
+	uint32_t break_pc; /* run_until_pc target, blocks end before it */
+#ifdef FUSION_STATS
+	unsigned long fused[FUSE_COUNT]; /* Times each fused pair ran */
+#endif
+};
+
+void block_cache_flush(struct BlockCache* bc)
 {
-	RRCr(c,m,&c->reg.C);
-	CYCLES(8);
+	int i;
+	for(i=0; i<BLOCK_SLOTS; ++i)
+	{
+		bc->slot[i].pc=BLOCK_INVALID;
+	}
+	bc->stop[0].pc=bc->stop[1].pc=BLOCK_INVALID;
+	memset(bc->code, 0, sizeof(bc->code));
+#ifdef FUSION_STATS
+	memset(bc->fused, 0, sizeof(bc->fused));
+#endif
 }
 
-void RRCD(CPU* c, MMU* m)
+struct BlockCache* block_cache_create(void)
 {
-	RRCr(c,m,&c->reg.D);
-	CYCLES(8);
+	struct BlockCache* bc=malloc(sizeof(struct BlockCache));
+	if(!bc)
+	{
+		fprintf(stderr, "Failed to allocate block cache\n");
+		exit(EXIT_FAILURE);
+	}
+	block_cache_flush(bc);
+	bc->break_pc=BREAK_NONE;
+	return bc;
 }
 
-void RRCE(CPU* c, MMU* m)
+void block_cache_destroy(struct BlockCache* bc)
 {
-	RRCr(c,m,&c->reg.E);
-	CYCLES(8);
+	free(bc);
 }
 
-void RRCH(CPU* c, MMU* m)
+#ifdef FUSION_STATS
+void block_cache_report(struct BlockCache* bc)
 {
-	RRCr(c,m,&c->reg.H);
-	CYCLES(8);
+	int f;
+	for(f=0; f<FUSE_COUNT; ++f)
+	{
+		printf("Fused %s: %lu\n", Fusions[f].name, bc->fused[f]);
+	}
 }
+#endif
 
-void RRCL(CPU* c, MMU* m)
+static int block_fusion(MMU* m, uint16_t p)
 {
-	RRCr(c,m,&c->reg.L);
-	CYCLES(8);
+	int f;
+	for(f=0; f<FUSE_COUNT; ++f)
+	{
+		uint8_t op=mmu_read(m, p);
+		if(op==Fusions[f].first && mmu_read(m, p+OpInfos[op].len)==Fusions[f].second) return f;
+	}
+	return -1;
 }
 
-void RRCHL(CPU* c, MMU* m)
+static void block_decode(struct BlockCache* bc, Block* b, MMU* m, uint16_t pc,
+		void* const* ops, void* const* extops, void* const* fused, void* slow, void* live)
 {
-	RRCr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
+	uint16_t p=pc;
+	int n, i, f;
+	for(n=0; n<BLOCK_MAX; ++n)
+	{
+		UOp* u=&b->ops[n];
+		if(n && p==bc->break_pc) break;
+		if(!m->rd[p>>PAGE_SHIFT])
+		{
+			/* I/O registers such as DIV change without a store, code there is fetched as it runs */
+			u->pc=p;
+			u->op=live;
+			u->next=p;
+			u->imm=0;
+			++n;
+			break;
+		}
+		uint8_t op=mmu_read(m, p);
+		uint8_t len=OpInfos[op].len;
+		u->pc=p;
+		u->op=ops[op];
+		u->next=p+len;
+		u->imm=0;
+		if((uint16_t)(p+len)!=bc->break_pc && (f=block_fusion(m, p)) >= 0)
+		{
+			/* Immediate of the first op in the low byte, of the second in the high byte */
+			uint16_t q=p+len;
+			u->op=fused[f];
+			op=mmu_read(m, q);
+			if(len==2) u->imm=mmu_read(m, p+1);
+			if(OpInfos[op].len==2) u->imm |= mmu_read(m, q+1)<<8;
+			len+=OpInfos[op].len;
+			u->next=p+len;
+		}
+		else if(op==0xCB) u->op=extops[mmu_read(m, p+1)];
+		else if(u->op==slow) u->next=p+1; /* OpCodes[] fetches its own operands */
+		else if(len==2) u->imm=mmu_read(m, p+1);
+		else if(len==3) u->imm=WORD(mmu_read(m, p+2), mmu_read(m, p+1));
+		if((pc&(PAGE_SIZE-1))+(uint16_t)(p-pc)+len > PAGE_SIZE)
+		{
+			if(n) break;
+			/* Straddles two pages, fetched from whatever they map as it runs */
+			u->op=live;
+			u->next=p;
+			u->imm=0;
+			++n;
+			break;
+		}
+		for(i=0; i<len; ++i, ++p)
+		{
+			bc->code[p>>3] |= 1<<(p&7);
+		}
+		if(OpInfos[op].flow!=FLOW_NONE)
+		{
+			++n;
+			break;
+		}
+	}
+	b->ops[n].pc=BLOCK_INVALID;
+	b->len=p-pc;
+	b->pc=pc;
+	b->base=m->rd[pc>>PAGE_SHIFT];
 }
 
-void RRCAext(CPU* c, MMU* m)
+static const UOp* block_lookup(struct BlockCache* bc, MMU* m, uint16_t pc,
+		void* const* ops, void* const* extops, void* const* fused, void* slow, void* live)
 {
-	RRCr(c,m,&c->reg.A);
-	CYCLES(8);
+	Block* b=&bc->slot[pc & (BLOCK_SLOTS-1)];
+	if(b->pc!=pc || b->base!=m->rd[pc>>PAGE_SHIFT]) block_decode(bc, b, m, pc, ops, extops, fused, slow, live);
+	return b->ops;
 }
 
-void RLB(CPU* c, MMU* m)
+/* Blocks stay within their page, so only the ones starting between its base and addr can cover it */
+static void block_invalidate(struct BlockCache* bc, uint16_t addr)
 {
-	RLr(c,m,&c->reg.B);
-	CYCLES(8);
+	unsigned int pc;
+	bc->code[addr>>3] &= ~(1<<(addr&7));
+	for(pc=addr&~(PAGE_SIZE-1); pc<=addr; ++pc)
+	{
+		Block* b=&bc->slot[pc & (BLOCK_SLOTS-1)];
+		if(b->pc==pc && addr-pc < b->len)
+		{
+			b->pc=BLOCK_INVALID;
+		}
+	}
 }
 
-void RLC(CPU* c, MMU* m)
+#define T_NEXT() do { \
+	if(cyc >= end) goto t_event; \
+	if((++u)->pc != PC) { \
+		if(PC==bc->break_pc) goto out; \
+		u=block_lookup(bc, m, PC, ops, extops, fused, &&t_slow, &&t_live); } \
+	imm=u->imm; PC=u->next; \
+	goto *u->op; } while(0)
+#define T_IMM8() ((uint8_t)imm)
+#define T_IMM16() (imm)
+#define T_CODE(addr) do { \
+	if(bc->code[(addr)>>3] & (1<<((addr)&7))) { \
+		block_invalidate(bc, (addr)); \
+		u=bc->stop; \
+	} } while(0)
+/*
+ * C000-DDFF can also run and be written through its echo at E000-FDFF,
+ * check both. A mapper write can switch the bank under the running block,
+ * so it ends.
+ */
+#define T_WROTE(addr) do { \
+	uint16_t w_=(addr); \
+	T_CODE(w_); \
+	if((w_ >= 0xC000 && w_ < 0xDE00) || (w_ >= 0xE000 && w_ < 0xFE00)) T_CODE(w_ ^ 0x2000); \
+	else if(w_ < 0x8000) u=bc->stop; } while(0)
+/* Stops between the halves of a fused pair, PC goes back to the second */
+#define T_SPLIT(len) do { \
+	if(cyc >= end) { PC-=(len); goto t_event; } } while(0)
+#ifdef FUSION_STATS
+#define T_FUSED(f) (++bc->fused[f])
+#else
+#define T_FUSED(f) do { } while(0)
+#endif
+#else
+#define T_NEXT() do { \
+	if(cyc >= end) goto t_event; \
+	goto *ops[T_READ(PC++)]; } while(0)
+#define T_IMM8() (T_READ(PC++))
+#define T_IMM16() (PC+=2, WORD(T_READ(PC-1), T_READ(PC-2)))
+#define T_WROTE(addr) do { } while(0)
+#endif
+
+#ifdef ALU_TABLES
+#define T_ALU(table, r, n) do { \
+	uint16_t e_=table[WORD((r), (n))]; \
+	(r)=e_>>8; F=(F & 0x0F)|(e_ & 0xFF); } while(0)
+#endif
+
+#ifdef LAZY_FLAGS
+/*
+ * Lazy flags, selected with -DLAZY_FLAGS on top of THREADED_DISPATCH.
+ * The common ALU ops only compute their result and record the operation
+ * with its operands; F holds the flags from before that operation. Z comes
+ * straight from the recorded result, anything else reruns the helper on
+ * the saved operands. An op that sets all of Z, N, H and C simply replaces
+ * the pending one, as do INC, DEC and BIT since they only keep C.
+ */
+#define LF_NONE 0
+#define LF_INC 1
+#define LF_DEC 2
+#define LF_BIT 3 /* Up to here C is kept */
+#define LF_ADD 4
+#define LF_SUB 5
+#define LF_SBC 6
+#define LF_AND 7
+#define LF_XOR 8
+#define LF_OR 9
+#define LF_SLA 10
+#define LF_SRA 11
+#define LF_SWAP 12
+#define LF_SRL 13
+
+static uint8_t lazy_flags(uint8_t kind, uint8_t x, uint8_t y, uint8_t f)
+{
+	switch(kind)
+	{
+		case LF_INC: inc(&x, &f); break;
+		case LF_DEC: dec(&x, &f); break;
+		case LF_BIT: BITr(y, &x, &f); break;
+		case LF_ADD: ADDr_r(&x, &y, &f); break;
+		case LF_SUB: SUBr_r(&x, &y, &f); break;
+		case LF_SBC: SBCr_r(&x, &y, &f); break;
+		case LF_AND: ANDr_r(&x, &y, &f); break;
+		case LF_XOR: XORr_r(&x, &y, &f); break;
+		case LF_OR: ORr_r(&x, &y, &f); break;
+		case LF_SLA: SLAr(&x, &f); break;
+		case LF_SRA: SRAr(&x, &f); break;
+		case LF_SWAP: SWAPr(&x, &f); break;
+		case LF_SRL: SRLr(&x, &f); break;
+	}
+	return f;
+}
+
+#define T_SYNC() ((void)(lk && (F=lazy_flags(lk, lx, ly, F), lk=LF_NONE)))
+#define T_ZF() (lk ? (lr ? 0 : ZERO) : (F & ZERO))
+#define T_CF() (T_SYNC(), F & CARRY)
+#define T_LAZY(kind, r, n, op) do { \
+	uint8_t y_=(n); \
+	lk=(kind); lx=(r); ly=y_; lr=((r) op y_); } while(0)
+#define T_SHIFT(kind, r, val) do { \
+	lk=(kind); lx=(r); lr=(r)=(val); } while(0)
+#define T_KEEPC(kind, r, y, val) do { \
+	if(lk > LF_BIT) T_SYNC(); \
+	lk=(kind); lx=(r); ly=(y); lr=(val); } while(0)
+#define T_ADD(r, n) T_LAZY(LF_ADD, r, n, +=)
+#define T_ADC(r, n) do { T_SYNC(); T_LAZY(LF_ADD, r, (n)+((F & CARRY) ? 1 : 0), +=); } while(0)
+/* SUBr_r tests its operand again after subtracting, so SUB A,A sees 0 */
+#define T_SUB(r, n) do { \
+	if(&(r) == &(n)) (r)=0; \
+	T_LAZY(LF_SUB, r, n, -=); } while(0)
+#define T_SBC(r, n) T_LAZY(LF_SBC, r, n, -=)
+#define T_AND(r, n) T_LAZY(LF_AND, r, n, &=)
+#define T_XOR(r, n) T_LAZY(LF_XOR, r, n, ^=)
+#define T_OR(r, n) T_LAZY(LF_OR, r, n, |=)
+#define T_INC(r) T_KEEPC(LF_INC, r, 0, ++(r))
+#define T_DEC(r) T_KEEPC(LF_DEC, r, 0, --(r))
+#define T_BIT(b, r) T_KEEPC(LF_BIT, r, b, (r) & (1<<(b)))
+#define T_SLA(r) T_SHIFT(LF_SLA, r, (r)<<1)
+#define T_SRA(r) T_SHIFT(LF_SRA, r, ((r)>>1)|((r)&0x80))
+#define T_SWAP(r) T_SHIFT(LF_SWAP, r, ((r)<<4)|((r)>>4))
+#define T_SRL(r) T_SHIFT(LF_SRL, r, (r)>>1)
+#else
+#define T_SYNC() ((void)0)
+#define T_ZF() (F & ZERO)
+#define T_CF() (F & CARRY)
+#ifdef ALU_TABLES
+#define T_ADD(r, n) T_ALU(AluAdd, r, n)
+#define T_ADC(r, n) T_ALU(AluAdd, r, (uint8_t)((n)+((F & CARRY) ? 1 : 0)))
+/* SUB A,A as in the lazy T_SUB */
+#define T_SUB(r, n) do { \
+	if(&(r) == &(n)) (r)=0; \
+	T_ALU(AluSub, r, n); } while(0)
+#define T_SBC(r, n) T_ALU(AluSbc, r, n)
+#define T_INC(r) do { F=(F & (CARRY|0x0F))|AluInc[(r)]; (r)++; } while(0)
+#define T_DEC(r) do { F=(F & (CARRY|0x0F))|AluDec[(r)]; (r)--; } while(0)
+#else
+#define T_ADD(r, n) ADDr_r(&(r), &(n), &F)
+#define T_ADC(r, n) ADCr_r(&(r), &(n), &F)
+#define T_SUB(r, n) SUBr_r(&(r), &(n), &F)
+#define T_SBC(r, n) SBCr_r(&(r), &(n), &F)
+#define T_INC(r) inc(&(r), &F)
+#define T_DEC(r) dec(&(r), &F)
+#endif
+#define T_AND(r, n) ANDr_r(&(r), &(n), &F)
+#define T_XOR(r, n) XORr_r(&(r), &(n), &F)
+#define T_OR(r, n) ORr_r(&(r), &(n), &F)
+#define T_BIT(b, r) BITr(b, &(r), &F)
+#define T_SLA(r) SLAr(&(r), &F)
+#define T_SRA(r) SRAr(&(r), &F)
+#define T_SWAP(r) SWAPr(&(r), &F)
+#define T_SRL(r) SRLr(&(r), &F)
+#endif
+/* These read or keep parts of F, so pending flags are settled first */
+#ifdef ALU_TABLES
+#define T_CP(r, n) do { T_SYNC(); F=(F & (HALFCARRY|0x0F))|AluCp[WORD((r), (n))]; } while(0)
+#define T_DAA() do { \
+	T_SYNC(); \
+	uint16_t e_=AluDaa[A<<3|(F>>4 & 7)]; \
+	A=e_>>8; F=(F & 0x0F)|(e_ & 0xFF); } while(0)
+#else
+#define T_CP(r, n) do { T_SYNC(); CPr_r(&(r), &(n), &F); } while(0)
+#define T_DAA() do { T_SYNC(); DAAr(&A, &F); } while(0)
+#endif
+#define T_RLC(r) do { T_SYNC(); RLCr(&(r), &F); } while(0)
+#define T_RRC(r) do { T_SYNC(); RRCr(&(r), &F); } while(0)
+#define T_RL(r) do { T_SYNC(); RLr(&(r), &F); } while(0)
+#define T_RR(r) do { T_SYNC(); RRr(&(r), &F); } while(0)
+#define T_ADDHL(rr) do { T_SYNC(); ADDrr_rr(&HL, (rr), &F); } while(0)
+
+/* The handlers name the registers of the local copy R directly, as bytes or as pairs */
+#define A R.A
+#define F R.F
+#define B R.B
+#define C R.C
+#define D R.D
+#define E R.E
+#define H R.H
+#define L R.L
+#define BC R.BC
+#define DE R.DE
+#define HL R.HL
+#define T_SPILL() do { \
+	T_SYNC(); \
+	c->reg=R; \
+	c->SP=SP; c->PC=PC; c->c=cyc; } while(0)
+#define T_RELOAD() do { \
+	R=c->reg; \
+	SP=c->SP; PC=c->PC; cyc=c->c; } while(0)
+/* I/O callbacks can read and charge the clock or schedule events, so cyc goes through c->c around them */
+#define T_READ(addr) ({ \
+	uint16_t r_=(addr); \
+	uint8_t v_; \
+	if(__builtin_expect(m->rd[r_>>PAGE_SHIFT]!=0, 1)) v_=mmu_read(m, r_); \
+	else { c->c=cyc; v_=mmu_read_io(m, r_); cyc=c->c; end=m->sched.next; } \
+	v_; })
+#define T_WRITE(addr, val) do { \
+	uint16_t a_=(addr); \
+	if(__builtin_expect(m->wr[a_>>PAGE_SHIFT]!=0 && a_!=MMU_IE, 1)) mmu_write(m, a_, (val)); \
+	else { c->c=cyc; mmu_write(m, a_, (val)); cyc=c->c; end=m->sched.next; } \
+	T_WROTE(a_); } while(0)
+#define T_OP(label, body, cycles) label: { body; } cyc+=cycles; T_NEXT();
+
+#define T_LD_ROW(dst) \
+	T_OP(t_LD##dst##B, dst=B, 4) \
+	T_OP(t_LD##dst##C, dst=C, 4) \
+	T_OP(t_LD##dst##D, dst=D, 4) \
+	T_OP(t_LD##dst##E, dst=E, 4) \
+	T_OP(t_LD##dst##H, dst=H, 4) \
+	T_OP(t_LD##dst##L, dst=L, 4) \
+	T_OP(t_LD##dst##HL, dst=T_READ(HL), 8) \
+	T_OP(t_LD##dst##A, dst=A, 4)
+
+#define T_ALU_ROW(name, fn) \
+	T_OP(t_##name##B, fn(A, B), 4) \
+	T_OP(t_##name##C, fn(A, C), 4) \
+	T_OP(t_##name##D, fn(A, D), 4) \
+	T_OP(t_##name##E, fn(A, E), 4) \
+	T_OP(t_##name##H, fn(A, H), 4) \
+	T_OP(t_##name##L, fn(A, L), 4) \
+	T_OP(t_##name##HL, uint8_t n=T_READ(HL); fn(A, n), 8) \
+	T_OP(t_##name##A, fn(A, A), 4)
+
+#define T_ALU_IMM(label, fn) T_OP(label, uint8_t n=T_IMM8(); fn(A, n), 8)
+
+#define T_CB_ROW(name, fn) \
+	T_OP(t_##name##B, fn(B), 8) \
+	T_OP(t_##name##C, fn(C), 8) \
+	T_OP(t_##name##D, fn(D), 8) \
+	T_OP(t_##name##E, fn(E), 8) \
+	T_OP(t_##name##H, fn(H), 8) \
+	T_OP(t_##name##L, fn(L), 8) \
+	T_OP(t_##name##HL, uint8_t n=T_READ(HL); fn(n); T_WRITE(HL, n), 16)
+
+#define T_BIT_ROW(b) \
+	T_OP(t_BIT##b##B, T_BIT(b, B), 8) \
+	T_OP(t_BIT##b##C, T_BIT(b, C), 8) \
+	T_OP(t_BIT##b##D, T_BIT(b, D), 8) \
+	T_OP(t_BIT##b##E, T_BIT(b, E), 8) \
+	T_OP(t_BIT##b##H, T_BIT(b, H), 8) \
+	T_OP(t_BIT##b##L, T_BIT(b, L), 8) \
+	T_OP(t_BIT##b##HL, uint8_t n=T_READ(HL); T_BIT(b, n), 12) \
+	T_OP(t_BIT##b##A, T_BIT(b, A), 8)
+
+#define T_BITOP_ROW(name, fn, b) \
+	T_OP(t_##name##b##B, fn(b, &B), 8) \
+	T_OP(t_##name##b##C, fn(b, &C), 8) \
+	T_OP(t_##name##b##D, fn(b, &D), 8) \
+	T_OP(t_##name##b##E, fn(b, &E), 8) \
+	T_OP(t_##name##b##H, fn(b, &H), 8) \
+	T_OP(t_##name##b##L, fn(b, &L), 8) \
+	T_OP(t_##name##b##HL, uint8_t n=T_READ(HL); fn(b, &n); T_WRITE(HL, n), 16) \
+	T_OP(t_##name##b##A, fn(b, &A), 8)
+
+/* The T_OP cycles are the not taken ones, a taken branch adds the rest */
+#define T_JRcc(cond) do { int8_t e=T_IMM8(); if(cond) { PC+=e; cyc+=4; } } while(0)
+#define T_JPcc(cond) do { uint16_t nn=T_IMM16(); if(cond) { PC=nn; cyc+=4; } } while(0)
+#define T_CALLcc(cond) do { \
+	uint16_t nn=T_IMM16(); \
+	if(cond) \
+	{ \
+		SP-=2; \
+		T_WRITE(SP+1, PC>>8); \
+		T_WRITE(SP, PC&0xFF); \
+		PC=nn; \
+		cyc+=12; \
+	} } while(0)
+#define T_RETcc(cond, extra) do { \
+	if(cond) \
+	{ \
+		uint8_t lsb=T_READ(SP++); \
+		uint8_t msb=T_READ(SP++); \
+		PC=WORD(msb, lsb); \
+		cyc+=extra; \
+	} } while(0)
+#define T_RST(val) do { T_WRITE(--SP, PC>>8); T_WRITE(--SP, PC&0xFF); PC=val; } while(0)
+
+/* Run for at least budget clock cycles, returns the cycles actually run */
+uint64_t run_threaded(CPU* c, MMU* m, uint64_t budget)
+{
+	static void* const ops[256]={
+		&&t_NOP, &&t_LDBCnn, &&t_LDBCA, &&t_INCBC, &&t_INCB, &&t_DECB, &&t_LDBn, &&t_RLCA, &&t_LDnnSP, &&t_ADDHLBC, &&t_LDABC, &&t_DECBC, &&t_INCC, &&t_DECC, &&t_LDCn, &&t_RRCA,
+		&&t_slow, &&t_LDDEnn, &&t_LDDEA, &&t_INCDE, &&t_INCD, &&t_DECD, &&t_LDDn, &&t_RLA, &&t_JRn, &&t_ADDHLDE, &&t_LDADE, &&t_DECDE, &&t_INCE, &&t_DECE, &&t_LDEn, &&t_RRA,
+		&&t_JRNZn, &&t_LDHLnn, &&t_LDIHLA, &&t_INCHL, &&t_INCH, &&t_DECH, &&t_LDHn, &&t_DAA, &&t_JRZn, &&t_ADDHLHL, &&t_LDIAHL, &&t_DECHL, &&t_INCL, &&t_DECL, &&t_LDLn, &&t_CPL,
+		&&t_JRNCn, &&t_LDSPnn, &&t_LDDHLA, &&t_INCSP, &&t_INCHL2, &&t_DECHL2, &&t_LDHLn, &&t_SCF, &&t_JRCn, &&t_slow, &&t_LDDAHL, &&t_DECSP, &&t_INCA, &&t_DECA, &&t_LDAn, &&t_CCF,
+		&&t_LDBB, &&t_LDBC, &&t_LDBD, &&t_LDBE, &&t_LDBH, &&t_LDBL, &&t_LDBHL, &&t_LDBA, &&t_LDCB, &&t_LDCC, &&t_LDCD, &&t_LDCE, &&t_LDCH, &&t_LDCL, &&t_LDCHL, &&t_LDCA,
+		&&t_LDDB, &&t_LDDC, &&t_LDDD, &&t_LDDE, &&t_LDDH, &&t_LDDL, &&t_LDDHL, &&t_LDDA, &&t_LDEB, &&t_LDEC, &&t_LDED, &&t_LDEE, &&t_LDEH, &&t_LDEL, &&t_LDEHL, &&t_LDEA,
+		&&t_LDHB, &&t_LDHC, &&t_LDHD, &&t_LDHE, &&t_LDHH, &&t_LDHL, &&t_LDHHL, &&t_LDHA, &&t_LDLB, &&t_LDLC, &&t_LDLD, &&t_LDLE, &&t_LDLH, &&t_LDLL, &&t_LDLHL, &&t_LDLA,
+		&&t_LDHLB, &&t_LDHLC, &&t_LDHLD, &&t_LDHLE, &&t_LDHLH, &&t_LDHLL, &&t_slow, &&t_LDHLA, &&t_LDAB, &&t_LDAC, &&t_LDAD, &&t_LDAE, &&t_LDAH, &&t_LDAL, &&t_LDAHL, &&t_LDAA,
+		&&t_ADDAB, &&t_ADDAC, &&t_ADDAD, &&t_ADDAE, &&t_ADDAH, &&t_ADDAL, &&t_ADDAHL, &&t_ADDAA, &&t_ADCAB, &&t_ADCAC, &&t_ADCAD, &&t_ADCAE, &&t_ADCAH, &&t_ADCAL, &&t_ADCAHL, &&t_ADCAA,
+		&&t_SUBAB, &&t_SUBAC, &&t_SUBAD, &&t_SUBAE, &&t_SUBAH, &&t_SUBAL, &&t_SUBAHL, &&t_SUBAA, &&t_SBCAB, &&t_SBCAC, &&t_SBCAD, &&t_SBCAE, &&t_SBCAH, &&t_SBCAL, &&t_SBCAHL, &&t_SBCAA,
+		&&t_ANDB, &&t_ANDC, &&t_ANDD, &&t_ANDE, &&t_ANDH, &&t_ANDL, &&t_ANDHL, &&t_ANDA, &&t_XORB, &&t_XORC, &&t_XORD, &&t_XORE, &&t_XORH, &&t_XORL, &&t_XORHL, &&t_XORA,
+		&&t_ORB, &&t_ORC, &&t_ORD, &&t_ORE, &&t_ORH, &&t_ORL, &&t_ORHL, &&t_ORA, &&t_CPB, &&t_CPC, &&t_CPD, &&t_CPE, &&t_CPH, &&t_CPL_, &&t_CPHL, &&t_CPA,
+		&&t_RETNZ, &&t_POPBC, &&t_JPNZnn, &&t_JPnn, &&t_CALLNZnn, &&t_PUSHBC, &&t_ADDAn, &&t_RST0, &&t_RETZ, &&t_RET, &&t_JPZnn, &&t_Extops, &&t_CALLZnn, &&t_CALLnn, &&t_ADCAn, &&t_RST8,
+		&&t_RETNC, &&t_POPDE, &&t_JPNCnn, &&t_slow, &&t_CALLNCnn, &&t_PUSHDE, &&t_SUBAn, &&t_RST10, &&t_RETC, &&t_slow, &&t_JPCnn, &&t_slow, &&t_CALLCnn, &&t_slow, &&t_SBCAn, &&t_RST18,
+		&&t_LDHnA, &&t_POPHL, &&t_LDHCA, &&t_slow, &&t_slow, &&t_PUSHHL, &&t_ANDn, &&t_RST20, &&t_slow, &&t_JPHL, &&t_LDnnA, &&t_slow, &&t_slow, &&t_slow, &&t_XORn, &&t_RST28,
+		&&t_LDHAn, &&t_POPAF, &&t_slow, &&t_slow, &&t_slow, &&t_PUSHAF, &&t_ORn, &&t_RST30, &&t_slow, &&t_LDSPHL, &&t_LDAnn, &&t_slow, &&t_slow, &&t_slow, &&t_CPn, &&t_RST38
+	};
+	static void* const extops[256]={
+		&&t_RLCB, &&t_RLCC, &&t_RLCD, &&t_RLCE, &&t_RLCH, &&t_RLCL, &&t_RLCHL, &&t_RLCAext, &&t_RRCB, &&t_RRCC, &&t_RRCD, &&t_RRCE, &&t_RRCH, &&t_RRCL, &&t_RRCHL, &&t_RRCAext,
+		&&t_RLB, &&t_RLC, &&t_RLD, &&t_RLE, &&t_RLH, &&t_RLL, &&t_RLHL, &&t_RLAext, &&t_RRB, &&t_RRC, &&t_RRD, &&t_RRE, &&t_RRH, &&t_RRL, &&t_RRHL, &&t_RRAext,
+		&&t_SLAB, &&t_SLAC, &&t_SLAD, &&t_SLAE, &&t_SLAH, &&t_SLAL, &&t_SLAHL, &&t_SLAA, &&t_SRAB, &&t_SRAC, &&t_SRAD, &&t_SRAE, &&t_SRAH, &&t_SRAL, &&t_SRAHL, &&t_SRAA,
+		&&t_SWAPB, &&t_SWAPC, &&t_SWAPD, &&t_SWAPE, &&t_SWAPH, &&t_SWAPL, &&t_SWAPHL, &&t_SWAPA, &&t_SRLB, &&t_SRLC, &&t_SRLD, &&t_SRLE, &&t_SRLH, &&t_SRLL, &&t_SRLHL, &&t_SRLA,
+		&&t_BIT0B, &&t_BIT0C, &&t_BIT0D, &&t_BIT0E, &&t_BIT0H, &&t_BIT0L, &&t_BIT0HL, &&t_BIT0A, &&t_BIT1B, &&t_BIT1C, &&t_BIT1D, &&t_BIT1E, &&t_BIT1H, &&t_BIT1L, &&t_BIT1HL, &&t_BIT1A,
+		&&t_BIT2B, &&t_BIT2C, &&t_BIT2D, &&t_BIT2E, &&t_BIT2H, &&t_BIT2L, &&t_BIT2HL, &&t_BIT2A, &&t_BIT3B, &&t_BIT3C, &&t_BIT3D, &&t_BIT3E, &&t_BIT3H, &&t_BIT3L, &&t_BIT3HL, &&t_BIT3A,
+		&&t_BIT4B, &&t_BIT4C, &&t_BIT4D, &&t_BIT4E, &&t_BIT4H, &&t_BIT4L, &&t_BIT4HL, &&t_BIT4A, &&t_BIT5B, &&t_BIT5C, &&t_BIT5D, &&t_BIT5E, &&t_BIT5H, &&t_BIT5L, &&t_BIT5HL, &&t_BIT5A,
+		&&t_BIT6B, &&t_BIT6C, &&t_BIT6D, &&t_BIT6E, &&t_BIT6H, &&t_BIT6L, &&t_BIT6HL, &&t_BIT6A, &&t_BIT7B, &&t_BIT7C, &&t_BIT7D, &&t_BIT7E, &&t_BIT7H, &&t_BIT7L, &&t_BIT7HL, &&t_BIT7A,
+		&&t_RES0B, &&t_RES0C, &&t_RES0D, &&t_RES0E, &&t_RES0H, &&t_RES0L, &&t_RES0HL, &&t_RES0A, &&t_RES1B, &&t_RES1C, &&t_RES1D, &&t_RES1E, &&t_RES1H, &&t_RES1L, &&t_RES1HL, &&t_RES1A,
+		&&t_RES2B, &&t_RES2C, &&t_RES2D, &&t_RES2E, &&t_RES2H, &&t_RES2L, &&t_RES2HL, &&t_RES2A, &&t_RES3B, &&t_RES3C, &&t_RES3D, &&t_RES3E, &&t_RES3H, &&t_RES3L, &&t_RES3HL, &&t_RES3A,
+		&&t_RES4B, &&t_RES4C, &&t_RES4D, &&t_RES4E, &&t_RES4H, &&t_RES4L, &&t_RES4HL, &&t_RES4A, &&t_RES5B, &&t_RES5C, &&t_RES5D, &&t_RES5E, &&t_RES5H, &&t_RES5L, &&t_RES5HL, &&t_RES5A,
+		&&t_RES6B, &&t_RES6C, &&t_RES6D, &&t_RES6E, &&t_RES6H, &&t_RES6L, &&t_RES6HL, &&t_RES6A, &&t_RES7B, &&t_RES7C, &&t_RES7D, &&t_RES7E, &&t_RES7H, &&t_RES7L, &&t_RES7HL, &&t_RES7A,
+		&&t_SET0B, &&t_SET0C, &&t_SET0D, &&t_SET0E, &&t_SET0H, &&t_SET0L, &&t_SET0HL, &&t_SET0A, &&t_SET1B, &&t_SET1C, &&t_SET1D, &&t_SET1E, &&t_SET1H, &&t_SET1L, &&t_SET1HL, &&t_SET1A,
+		&&t_SET2B, &&t_SET2C, &&t_SET2D, &&t_SET2E, &&t_SET2H, &&t_SET2L, &&t_SET2HL, &&t_SET2A, &&t_SET3B, &&t_SET3C, &&t_SET3D, &&t_SET3E, &&t_SET3H, &&t_SET3L, &&t_SET3HL, &&t_SET3A,
+		&&t_SET4B, &&t_SET4C, &&t_SET4D, &&t_SET4E, &&t_SET4H, &&t_SET4L, &&t_SET4HL, &&t_SET4A, &&t_SET5B, &&t_SET5C, &&t_SET5D, &&t_SET5E, &&t_SET5H, &&t_SET5L, &&t_SET5HL, &&t_SET5A,
+		&&t_SET6B, &&t_SET6C, &&t_SET6D, &&t_SET6E, &&t_SET6H, &&t_SET6L, &&t_SET6HL, &&t_SET6A, &&t_SET7B, &&t_SET7C, &&t_SET7D, &&t_SET7E, &&t_SET7H, &&t_SET7L, &&t_SET7HL, &&t_SET7A
+	};
+	Z80Reg R;
+	uint16_t SP, PC;
+	uint64_t cyc;
+#ifdef LAZY_FLAGS
+	uint8_t lk=LF_NONE, lx=0, ly=0, lr=0; /* Pending flag operation */
+#endif
+#ifdef BLOCK_CACHE
+	static void* const fused[FUSE_COUNT]={
+		&&t_DECB_JRNZn, &&t_LDIAHL_LDDEA, &&t_LDHAn_CPn
+	};
+	struct BlockCache* bc=c->blocks;
+	const UOp* u=bc->stop;
+	uint16_t imm;
+#endif
+#ifdef ALU_TABLES
+	alu_tables_init();
+#endif
+	T_RELOAD();
+	const uint64_t start=cyc;
+	sched_limit(m, start+budget);
+	if(c->halt)
+	{
+		halt_skip(c,m);
+		cyc=c->c;
+	}
+	uint64_t end=m->sched.next; /* Next event or the end of the budget */
+	T_NEXT();
+
+	/* 0 */
+	T_OP(t_NOP, , 4)
+	T_OP(t_LDBCnn, BC=T_IMM16(), 12)
+	T_OP(t_LDBCA, T_WRITE(BC, A), 8)
+	T_OP(t_INCBC, BC++, 8)
+	T_OP(t_INCB, T_INC(B), 4)
+	T_OP(t_DECB, T_DEC(B), 4)
+	T_OP(t_LDBn, B=T_IMM8(), 8)
+	T_OP(t_RLCA, T_RLC(A), 4)
+	T_OP(t_LDnnSP, T_WRITE(T_IMM16(), SP), 20)
+	T_OP(t_ADDHLBC, T_ADDHL(BC), 8)
+	T_OP(t_LDABC, A=T_READ(BC), 8)
+	T_OP(t_DECBC, BC--, 8)
+	T_OP(t_INCC, T_INC(C), 4)
+	T_OP(t_DECC, T_DEC(C), 4)
+	T_OP(t_LDCn, C=T_IMM8(), 8)
+	T_OP(t_RRCA, T_RRC(A), 4)
+
+	/* 1 */
+	T_OP(t_LDDEnn, DE=T_IMM16(), 12)
+	T_OP(t_LDDEA, T_WRITE(DE, A), 8)
+	T_OP(t_INCDE, DE++, 8)
+	T_OP(t_INCD, T_INC(D), 4)
+	T_OP(t_DECD, T_DEC(D), 4)
+	T_OP(t_LDDn, D=T_IMM8(), 8)
+	T_OP(t_RLA, T_RL(A), 4)
+	T_OP(t_JRn, T_JRcc(1), 8)
+	T_OP(t_ADDHLDE, T_ADDHL(DE), 8)
+	T_OP(t_LDADE, A=T_READ(DE), 8)
+	T_OP(t_DECDE, DE--, 8)
+	T_OP(t_INCE, T_INC(E), 4)
+	T_OP(t_DECE, T_DEC(E), 4)
+	T_OP(t_LDEn, E=T_IMM8(), 8)
+	T_OP(t_RRA, T_RR(A), 4)
+
+	/* 2 */
+	T_OP(t_JRNZn, T_JRcc(!T_ZF()), 8)
+	T_OP(t_LDHLnn, HL=T_IMM16(), 12)
+	T_OP(t_LDIHLA, T_WRITE(HL, A); HL++, 8)
+	T_OP(t_INCHL, HL++, 8)
+	T_OP(t_INCH, T_INC(H), 4)
+	T_OP(t_DECH, T_DEC(H), 4)
+	T_OP(t_LDHn, H=T_IMM8(), 8)
+	T_OP(t_DAA, T_DAA(), 4)
+	T_OP(t_JRZn, T_JRcc(T_ZF()), 8)
+	T_OP(t_ADDHLHL, T_ADDHL(HL), 8)
+	T_OP(t_LDIAHL, A=T_READ(HL); HL++, 8)
+	T_OP(t_DECHL, HL--, 8)
+	T_OP(t_INCL, T_INC(L), 4)
+	T_OP(t_DECL, T_DEC(L), 4)
+	T_OP(t_LDLn, L=T_IMM8(), 8)
+	T_OP(t_CPL, T_SYNC(); F |= SUBTRACT|HALFCARRY; A=~A, 4)
+
+	/* 3 */
+	T_OP(t_JRNCn, T_JRcc(!T_CF()), 8)
+	T_OP(t_LDSPnn, SP=T_IMM16(), 12)
+	T_OP(t_LDDHLA, T_WRITE(HL, A); HL--, 8)
+	T_OP(t_INCSP, SP++, 8)
+	T_OP(t_INCHL2, uint8_t n=T_READ(HL); T_INC(n); T_WRITE(HL, n), 12)
+	T_OP(t_DECHL2, uint8_t n=T_READ(HL); T_DEC(n); T_WRITE(HL, n), 12)
+	T_OP(t_LDHLn, T_WRITE(HL, T_IMM8()), 12)
+	T_OP(t_SCF, T_SYNC(); F &= ~(SUBTRACT|HALFCARRY); F |= CARRY, 4)
+	T_OP(t_JRCn, T_JRcc(T_CF()), 8)
+	T_OP(t_LDDAHL, A=T_READ(HL); HL--, 8)
+	T_OP(t_DECSP, SP--, 8)
+	T_OP(t_INCA, T_INC(A), 4)
+	T_OP(t_DECA, T_DEC(A), 4)
+	T_OP(t_LDAn, A=T_IMM8(), 8)
+	T_OP(t_CCF, T_SYNC(); F &= ~(SUBTRACT|HALFCARRY|CARRY), 4)
+
+	/* 4 - 7 */
+	T_LD_ROW(B)
+	T_LD_ROW(C)
+	T_LD_ROW(D)
+	T_LD_ROW(E)
+	T_LD_ROW(H)
+	T_LD_ROW(L)
+	T_OP(t_LDHLB, T_WRITE(HL, B), 8)
+	T_OP(t_LDHLC, T_WRITE(HL, C), 8)
+	T_OP(t_LDHLD, T_WRITE(HL, D), 8)
+	T_OP(t_LDHLE, T_WRITE(HL, E), 8)
+	T_OP(t_LDHLH, T_WRITE(HL, H), 8)
+	T_OP(t_LDHLL, T_WRITE(HL, L), 8)
+	T_OP(t_LDHLA, T_WRITE(HL, A), 8)
+	T_LD_ROW(A)
+
+	/* 8 - B */
+	T_ALU_ROW(ADDA, T_ADD)
+	T_ALU_ROW(ADCA, T_ADC)
+	T_ALU_ROW(SUBA, T_SUB)
+	T_ALU_ROW(SBCA, T_SBC)
+	T_ALU_ROW(AND, T_AND)
+	T_ALU_ROW(XOR, T_XOR)
+	T_ALU_ROW(OR, T_OR)
+	T_OP(t_CPB, T_CP(A, B), 4)
+	T_OP(t_CPC, T_CP(A, C), 4)
+	T_OP(t_CPD, T_CP(A, D), 4)
+	T_OP(t_CPE, T_CP(A, E), 4)
+	T_OP(t_CPH, T_CP(A, H), 4)
+	T_OP(t_CPL_, T_CP(A, L), 4)
+	T_OP(t_CPHL, uint8_t n=T_READ(HL); T_CP(A, n), 8)
+	T_OP(t_CPA, T_CP(A, A), 4)
+
+	/* C */
+	T_OP(t_RETNZ, T_RETcc(!T_ZF(), 12), 8)
+	T_OP(t_POPBC, C=T_READ(SP++); B=T_READ(SP++), 12)
+	T_OP(t_JPNZnn, T_JPcc(!T_ZF()), 12)
+	T_OP(t_JPnn, PC=T_IMM16(), 16)
+	T_OP(t_CALLNZnn, T_CALLcc(!T_ZF()), 12)
+	T_OP(t_PUSHBC, T_WRITE(--SP, B); T_WRITE(--SP, C), 16)
+	T_ALU_IMM(t_ADDAn, T_ADD)
+	T_OP(t_RST0, T_RST(0), 16)
+	T_OP(t_RETZ, T_RETcc(T_ZF(), 12), 8)
+	T_OP(t_RET, T_RETcc(1, 8), 8)
+	T_OP(t_JPZnn, T_JPcc(T_ZF()), 12)
+t_Extops:
+	goto *extops[T_READ(PC++)];
+	T_OP(t_CALLZnn, T_CALLcc(T_ZF()), 12)
+	T_OP(t_CALLnn, T_CALLcc(1), 12)
+	T_ALU_IMM(t_ADCAn, T_ADC)
+	T_OP(t_RST8, T_RST(0x8), 16)
+
+	/* D */
+	T_OP(t_RETNC, T_RETcc(!T_CF(), 12), 8)
+	T_OP(t_POPDE, E=T_READ(SP++); D=T_READ(SP++), 12)
+	T_OP(t_JPNCnn, T_JPcc(!T_CF()), 12)
+	T_OP(t_CALLNCnn, T_CALLcc(!T_CF()), 12)
+	T_OP(t_PUSHDE, T_WRITE(--SP, D); T_WRITE(--SP, E), 16)
+	T_ALU_IMM(t_SUBAn, T_SUB)
+	T_OP(t_RST10, T_RST(0x10), 16)
+	T_OP(t_RETC, T_RETcc(T_CF(), 12), 8)
+	T_OP(t_JPCnn, T_JPcc(T_CF()), 12)
+	T_OP(t_CALLCnn, T_CALLcc(T_CF()), 12)
+	T_ALU_IMM(t_SBCAn, T_SBC)
+	T_OP(t_RST18, T_RST(0x18), 16)
+
+	/* E */
+	T_OP(t_LDHnA, T_WRITE(0xFF00 + T_IMM8(), A), 12)
+	T_OP(t_POPHL, L=T_READ(SP++); H=T_READ(SP++), 12)
+	T_OP(t_LDHCA, T_WRITE(0xFF00 + C, A), 8)
+	T_OP(t_PUSHHL, T_WRITE(--SP, H); T_WRITE(--SP, L), 16)
+	T_ALU_IMM(t_ANDn, T_AND)
+	T_OP(t_RST20, T_RST(0x20), 16)
+	T_OP(t_JPHL, PC=HL, 4)
+	T_OP(t_LDnnA, T_WRITE(T_IMM16(), A), 16)
+	T_ALU_IMM(t_XORn, T_XOR)
+	T_OP(t_RST28, T_RST(0x28), 16)
+
+	/* F */
+	T_OP(t_LDHAn, A=T_READ(0xFF00 + T_IMM8()), 12)
+	T_OP(t_POPAF, T_SYNC(); F=T_READ(SP++); A=T_READ(SP++), 12)
+	T_OP(t_PUSHAF, T_SYNC(); T_WRITE(--SP, A); T_WRITE(--SP, F), 16)
+	T_ALU_IMM(t_ORn, T_OR)
+	T_OP(t_RST30, T_RST(0x30), 16)
+	T_OP(t_LDSPHL, SP=HL, 8)
+	T_OP(t_LDAnn, A=T_READ(T_IMM16()), 16)
+	T_ALU_IMM(t_CPn, T_CP)
+	T_OP(t_RST38, T_RST(0x38), 16)
+
+	/* CB */
+	T_CB_ROW(RLC, T_RLC)
+	T_OP(t_RLCAext, T_RLC(A), 8)
+	T_CB_ROW(RRC, T_RRC)
+	T_OP(t_RRCAext, T_RRC(A), 8)
+	T_CB_ROW(RL, T_RL)
+	T_OP(t_RLAext, T_RL(A), 8)
+	T_CB_ROW(RR, T_RR)
+	T_OP(t_RRAext, T_RR(A), 8)
+	T_CB_ROW(SLA, T_SLA)
+	T_OP(t_SLAA, T_SLA(A), 8)
+	T_CB_ROW(SRA, T_SRA)
+	T_OP(t_SRAA, T_SRA(A), 8)
+	T_CB_ROW(SWAP, T_SWAP)
+	T_OP(t_SWAPA, T_SWAP(A), 8)
+	T_CB_ROW(SRL, T_SRL)
+	T_OP(t_SRLA, T_SRL(A), 8)
+	T_BIT_ROW(0)
+	T_BIT_ROW(1)
+	T_BIT_ROW(2)
+	T_BIT_ROW(3)
+	T_BIT_ROW(4)
+	T_BIT_ROW(5)
+	T_BIT_ROW(6)
+	T_BIT_ROW(7)
+	T_BITOP_ROW(RES, RESr, 0)
+	T_BITOP_ROW(RES, RESr, 1)
+	T_BITOP_ROW(RES, RESr, 2)
+	T_BITOP_ROW(RES, RESr, 3)
+	T_BITOP_ROW(RES, RESr, 4)
+	T_BITOP_ROW(RES, RESr, 5)
+	T_BITOP_ROW(RES, RESr, 6)
+	T_BITOP_ROW(RES, RESr, 7)
+	T_BITOP_ROW(SET, SETr, 0)
+	T_BITOP_ROW(SET, SETr, 1)
+	T_BITOP_ROW(SET, SETr, 2)
+	T_BITOP_ROW(SET, SETr, 3)
+	T_BITOP_ROW(SET, SETr, 4)
+	T_BITOP_ROW(SET, SETr, 5)
+	T_BITOP_ROW(SET, SETr, 6)
+	T_BITOP_ROW(SET, SETr, 7)
+
+#ifdef BLOCK_CACHE
+	T_OP(t_DECB_JRNZn, T_FUSED(FUSE_DECB_JRNZ); T_DEC(B); cyc+=4; T_SPLIT(2);
+		if(!T_ZF()) { PC+=(int8_t)(imm>>8); cyc+=4; }, 8)
+	T_OP(t_LDIAHL_LDDEA, T_FUSED(FUSE_LDIAHL_LDDEA); A=T_READ(HL); HL++; cyc+=8; T_SPLIT(1);
+		T_WRITE(DE, A), 8)
+	T_OP(t_LDHAn_CPn, T_FUSED(FUSE_LDHAN_CPN); A=T_READ(0xFF00 + (imm&0xFF)); cyc+=12; T_SPLIT(2);
+		uint8_t n=imm>>8; T_CP(A, n), 8)
+#endif
+
+t_slow:
+	/* HALT, STOP, DI/EI, RETI and the SP arithmetic */
+	T_SPILL();
+	{
+		uint8_t op=T_READ(PC-1);
+		OpCodes[op](c,m);
+		c->c+=OpInfos[op].cycles;
+	}
+	T_RELOAD();
+	end=m->sched.next;
+	T_NEXT();
+
+#ifdef BLOCK_CACHE
+t_live:
+	/* Decoded again every time, the handler then stores through T_WRITE like any other */
+	u=bc->stop;
+	{
+		uint8_t op=T_READ(PC);
+		void* h=ops[op];
+		if(h==&&t_slow)
+		{
+			++PC;
+			goto t_slow;
+		}
+		if(op==0xCB) h=extops[T_READ(PC+1)];
+		else if(OpInfos[op].len==2) imm=T_READ(PC+1);
+		else if(OpInfos[op].len==3) imm=WORD(T_READ(PC+2), T_READ(PC+1));
+		PC+=OpInfos[op].len;
+		goto *h;
+	}
+#endif
+
+t_event:
+	if(cyc-start >= budget) goto out;
+#ifdef BLOCK_CACHE
+	if(PC==bc->break_pc) goto out; /* Before an interrupt or HALT moves on */
+#endif
+	c->c=cyc;
+	sched_run(m);
+	if(m->irq)
+	{
+		T_SPILL();
+		interrupt(c,m);
+		T_RELOAD();
+		T_WROTE(SP);
+		T_WROTE(SP+1);
+	}
+	else if(c->halt) halt_skip(c,m);
+	cyc=c->c;
+	end=m->sched.next;
+	T_NEXT();
+
+out:
+	T_SPILL();
+	sched_limit(m, UINT64_MAX);
+	return cyc-start;
+}
+#undef A
+#undef F
+#undef B
+#undef C
+#undef D
+#undef E
+#undef H
+#undef L
+#undef BC
+#undef DE
+#undef HL
+#endif
+
+/* Runs the instruction at PC, the handlers only add the extra cycles of a taken branch */
+static inline void dispatch(CPU* c, MMU* m)
+{
+	uint8_t op=mmu_read(m, c->PC++);
+	OpCodes[op](c,m);
+	CYCLES(OpInfos[op].cycles);
+}
+
+/* Runs one instruction, or takes the interrupt that is due or sleeps in HALT instead */
+void execute_next(CPU* c, MMU* m)
 {
-	RLr(c,m,&c->reg.C);
-	CYCLES(8);
+	if(c->c >= m->sched.next)
+	{
+		sched_run(m);
+		if(m->irq)
+		{
+			interrupt(c,m);
+			return;
+		}
+	}
+	if(c->halt)
+	{
+		halt_skip(c,m);
+		return;
+	}
+	dispatch(c,m);
 }
 
-void RLD(CPU* c, MMU* m)
+/* Runs the selected core for at least budget cycles or up to the breakpoint, returns cycles run */
+static uint64_t run_core(CPU* c, MMU* m, uint64_t budget)
 {
-	RLr(c,m,&c->reg.D);
-	CYCLES(8);
+#ifdef THREADED_DISPATCH
+	return run_threaded(c,m,budget);
+#else
+	const uint64_t start=c->c;
+	sched_limit(m, start+budget);
+	if(c->halt) halt_skip(c,m);
+	for(;;)
+	{
+		/* The end of the budget is in sched.next too, one compare covers both */
+		if(c->c >= m->sched.next)
+		{
+			if(c->c-start >= budget) break;
+#ifndef JIT
+			sched_run(m);
+			if(m->irq) interrupt(c,m);
+			else if(c->halt) halt_skip(c,m);
+			continue;
+#endif
+		}
+#ifdef JIT
+		/* Events, interrupts and HALT go through execute_next in there, after the breakpoint */
+		if(!jit_execute(c,m)) break;
+#else
+		dispatch(c,m);
+#endif
+	}
+	sched_limit(m, UINT64_MAX);
+	return c->c-start;
+#endif
 }
 
-void RLE(CPU* c, MMU* m)
+int64_t run_cycles(CPU* c, uint64_t budget)
 {
-	RLr(c,m,&c->reg.E);
-	CYCLES(8);
+	return run_core(c, &c->MMU, budget)-budget;
 }
 
-void RLH(CPU* c, MMU* m)
+#if defined(BLOCK_CACHE) || defined(JIT)
+/* Blocks end before pc from now on, so the core can stop there between two of them */
+static void core_break(CPU* c, uint32_t pc)
 {
-	RLr(c,m,&c->reg.H);
-	CYCLES(8);
+#ifdef BLOCK_CACHE
+	c->blocks->break_pc=pc;
+	if(pc!=BREAK_NONE) block_invalidate(c->blocks, pc);
+#else
+	jit_break(c->jit, pc);
+#endif
 }
+#endif
 
-void RLL(CPU* c, MMU* m)
+int64_t run_until_pc(CPU* c, uint16_t pc, uint64_t budget)
 {
-	RLr(c,m,&c->reg.L);
-	CYCLES(8);
+	MMU* m=&c->MMU;
+	uint64_t done=0;
+#if defined(BLOCK_CACHE) || defined(JIT)
+	core_break(c, pc);
+	while(c->PC!=pc && done < budget)
+	{
+		done+=run_core(c,m,budget-done);
+	}
+	core_break(c, BREAK_NONE);
+#else
+#ifdef THREADED_DISPATCH
+	/*
+	 * Every instruction is a boundary here, a budget of one cycle runs one
+	 * of them. That would also end HALT's sleep after a cycle, so HALT and
+	 * the halted CPU are stepped by the table core with the rest of the budget.
+	 */
+	while(c->PC!=pc && done < budget)
+	{
+		if(c->halt || mmu_read(m, c->PC)==0x76)
+		{
+			uint64_t last=c->c;
+			sched_limit(m, last+budget-done);
+			execute_next(c,m);
+			sched_limit(m, UINT64_MAX);
+			done+=c->c-last;
+		}
+		else done+=run_threaded(c,m,1);
+	}
+#else
+	/* Every instruction is a boundary here, stepped by the table core */
+	uint64_t last=c->c;
+	sched_limit(m, last+budget); /* Bounds a HALT */
+	while(c->PC!=pc && done < budget)
+	{
+		execute_next(c,m);
+		done+=c->c-last;
+		last=c->c;
+	}
+	sched_limit(m, UINT64_MAX);
+#endif
+#endif
+	return done-budget;
 }
 
-void RLHL(CPU* c, MMU* m)
+int64_t run_frame(CPU* c)
 {
-	RLr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
+	c->frame_over=run_cycles(c, FRAME_CYCLES-c->frame_over);
+	cart_frame(&c->MMU);
+	return c->frame_over;
 }
 
-void RLAext(CPU* c, MMU* m)
+void reset(CPU* c)
 {
-	RLr(c,m,&c->reg.A);
-	CYCLES(8);
+	c->reg.A=c->reg.B=c->reg.C=c->reg.D=c->reg.E=c->reg.H=c->reg.L=c->reg.F=c->PC=0;
+	c->SP=0xFFFE;
 }
 
-void RRB(CPU* c, MMU* m)
+static void write_bios(MMU* m)
 {
-	RRr(c,m,&c->reg.B);
-	CYCLES(8);
+	mmu_map(m, 0, 0x100, (uint8_t*)Bios, 0); /* Over the start of the cartridge */
 }
 
-void RRC(CPU* c, MMU* m)
+static void run_bios(CPU* c, MMU* m)
 {
-	RRr(c,m,&c->reg.C);
-	CYCLES(8);
+	while(c->PC!=256)
+	{
+		printf("BIOS: 0x%x, PC: %d\n", mmu_read(m, c->PC), c->PC);
+		execute_next(c,m);
+	}
+	cart_remap(m); // Unmap bios
+}
+
+#ifdef SELF_CHECK
+/* Runs op with F set to flags and checks the extra cycles it charges, HALT's sleep aside */
+static void check_cycles(CPU* c, OpCode op, uint8_t flags, const OpInfo* info)
+{
+	uint64_t before;
+	unsigned int spent;
+	c->PC=0x101; /* Past the opcode, as execute_next leaves it */
+	c->SP=0xD000;
+	c->reg.BC=c->reg.DE=c->reg.HL=0xC000;
+	c->reg.F=flags;
+	c->halt=0;
+	before=c->c-c->halted;
+	op(c, &c->MMU);
+	spent=c->c-c->halted-before;
+	if(spent && (!info->taken || spent!=info->taken-info->cycles))
+	{
+		fprintf(stderr, "%s adds %u cycles, OpInfos says %u\n", info->name, spent, info->taken ? info->taken-info->cycles : 0);
+		exit(EXIT_FAILURE);
+	}
 }
 
-void RRD(CPU* c, MMU* m)
-{
-	RRr(c,m,&c->reg.D);
-	CYCLES(8);
+/*
+ * The dispatch charges the OpInfos cycles and a handler only adds the
+ * rest of a taken branch, so every handler is run once on a scratch
+ * instance against the table, conditional ones both ways. Then RST, RET
+ * and JP (HL) go round on the selected core to check the return address,
+ * and a store patches the instruction right after it.
+ */
+static void cpu_check(void)
+{
+	static const uint8_t Smc[]={0x3E, 0xB4, 0xEA, 0x06, 0xC2, 0x06, 0x3F, 0x0E, 0x00, 0x18, 0xFE};
+	static uint8_t rom[0x8000];
+	CPU* c=calloc(1, sizeof(CPU));
+	MMU* m=&c->MMU;
+	int op;
+	if(!c)
+	{
+		fprintf(stderr, "Failed to allocate the check instance\n");
+		exit(EXIT_FAILURE);
+	}
+	mmu_init(m, &c->c, &c->ime);
+	mmu_map(m, 0, 0x8000, rom, 0);
+	for(op=0; op<256; ++op)
+	{
+		if(!OpCodes[op] || op==0xCB) continue;
+		check_cycles(c, OpCodes[op], 0, &OpInfos[op]);
+		check_cycles(c, OpCodes[op], ZERO|SUBTRACT|HALFCARRY|CARRY, &OpInfos[op]);
+	}
+	for(op=0; op<256; ++op)
+	{
+		check_cycles(c, ExtOps[op], 0, &ExtOpInfos[op]);
+	}
+	rom[0x38]=0xC9; /* RET */
+	mmu_write(m, 0xC000, 0xFF); /* RST 38H */
+	mmu_write(m, 0xC001, 0xE9); /* JP (HL) */
+	c->PC=0xC000;
+	c->SP=0xD000;
+	c->reg.HL=0xC010;
+	c->ime=0;
+	irq_update(m);
+	sched_cancel(m, EV_EI);
+#ifdef BLOCK_CACHE
+	c->blocks=block_cache_create();
+#endif
+#ifdef JIT
+	c->jit=jit_create();
+#endif
+	run_core(c, m, OpInfos[0xFF].cycles+OpInfos[0xC9].cycles+OpInfos[0xE9].cycles);
+	if(c->PC!=0xC010 || c->SP!=0xD000 || mmu_read(m, 0xCFFF)!=0xC0 || mmu_read(m, 0xCFFE)!=0x01)
+	{
+		fprintf(stderr, "RST came back to %04X with SP %04X\n", c->PC, c->SP);
+		exit(EXIT_FAILURE);
+	}
+	/* LD (C206),A patches the operand of the LD B that follows it, often enough to get compiled */
+	for(op=0; op<sizeof(Smc); ++op)
+	{
+		mmu_write(m, 0xC200+op, Smc[op]);
+	}
+	for(op=0; op<256; ++op)
+	{
+		mmu_write(m, 0xC206, 0x3F);
+		c->PC=0xC200;
+		run_core(c, m, OpInfos[0x3E].cycles+OpInfos[0xEA].cycles+OpInfos[0x06].cycles+OpInfos[0x0E].cycles+OpInfos[0x18].cycles);
+		if(c->PC!=0xC209 || c->reg.BC!=0xB400)
+		{
+			fprintf(stderr, "Patched code ran stale, BC %04X at %04X\n", c->reg.BC, c->PC);
+			exit(EXIT_FAILURE);
+		}
+	}
+#ifdef BLOCK_CACHE
+	block_cache_destroy(c->blocks);
+#endif
+#ifdef JIT
+	jit_destroy(c->jit);
+#endif
+	free(c);
+}
+#endif
+
+#ifdef BENCHMARK
+#include <time.h>
+
+#define BENCH_LOOP_CYCLES (1ull<<30)
+#define BENCH_PROGRAMS 200
+#define BENCH_PROGRAM_CYCLES (60*FRAME_CYCLES) /* A second of guest time each */
+
+static double seconds(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec+t.tv_nsec/1e9;
+}
+
+/* A fresh instance on a flat ROM that stores can write to, with the selected core attached */
+static void bench_reset(CPU* c, uint8_t* rom)
+{
+	MMU* m=&c->MMU;
+	memset(&c->reg, 0, sizeof(c->reg));
+	c->ime=c->halt=c->stop=0;
+	c->c=c->halted=0;
+	mmu_init(m, &c->c, &c->ime);
+	mmu_map(m, 0, 0x8000, rom, rom);
+	c->SP=0xDFF0;
+#ifdef BLOCK_CACHE
+	block_cache_flush(c->blocks);
+#endif
+#ifdef JIT
+	jit_flush(c->jit);
+#endif
+}
+
+/*
+ * Release build with -DBENCHMARK: emulated MHz of the selected core on a
+ * tight load/ALU/store loop and on random programs, which store into
+ * their own code and jump all over it. The two bound what compiled and
+ * cached code can gain, compare builds of the same tree with it.
+ */
+static void benchmark(void)
+{
+	static const uint8_t Loop[]={
+		0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x06, 0x00, /* LD HL,C000; LD DE,D000; LD B,0 */
+		0x2A, 0x12, 0x13, 0xCB, 0x7F, 0x80, 0xE6, 0x0F, 0x05, 0x20, 0xF5, /* LD A,(HL+); LD (DE),A; INC DE; BIT 7,A; ADD A,B; AND 0F; DEC B; JR NZ */
+		0xC3, 0x00, 0x01 /* JP 0100 */
+	};
+	static uint8_t rom[0x8000];
+	CPU* c=calloc(1, sizeof(CPU));
+	double t, loop, random=0;
+	uint64_t cycles=0;
+	int i, op;
+	if(!c)
+	{
+		fprintf(stderr, "Failed to allocate the benchmark instance\n");
+		exit(EXIT_FAILURE);
+	}
+#ifdef BLOCK_CACHE
+	c->blocks=block_cache_create();
+#endif
+#ifdef JIT
+	c->jit=jit_create();
+#endif
+	/* Stores write undefined opcodes too, they run as NOPs here */
+	for(op=0; op<256; ++op)
+	{
+		if(!OpCodes[op]) OpCodes[op]=NOP;
+	}
+	bench_reset(c, rom);
+	memcpy(rom+0x100, Loop, sizeof(Loop));
+	c->PC=0x100;
+	t=seconds();
+	run_cycles(c, BENCH_LOOP_CYCLES);
+	loop=c->c/(seconds()-t)/1e6;
+	for(i=0; i<BENCH_PROGRAMS; ++i)
+	{
+		srand(i+1);
+		bench_reset(c, rom);
+		for(op=0; op<0x8000; ++op)
+		{
+			/* No HALT or STOP, they would only sleep */
+			do rom[op]=rand(); while(!OpCodes[rom[op]] || rom[op]==0x76 || rom[op]==0x10);
+		}
+		for(op=0x8000; op<0xE000; ++op)
+		{
+			do c->MMU.mem[op-MEM_BASE]=rand(); while(!OpCodes[c->MMU.mem[op-MEM_BASE]] || c->MMU.mem[op-MEM_BASE]==0x76 || c->MMU.mem[op-MEM_BASE]==0x10);
+		}
+		c->PC=rand()&0x7FFF;
+		t=seconds();
+		run_cycles(c, BENCH_PROGRAM_CYCLES);
+		random+=seconds()-t;
+		cycles+=c->c;
+	}
+	printf("Emulated MHz: loop %.0f, random %.0f\n", loop, cycles/random/1e6);
+#ifdef BLOCK_CACHE
+	block_cache_destroy(c->blocks);
+#endif
+#ifdef JIT
+	jit_destroy(c->jit);
+#endif
+	free(c);
 }
+#endif
 
-void RRE(CPU* c, MMU* m)
-{
-	RRr(c,m,&c->reg.E);
-	CYCLES(8);
-}
+static volatile sig_atomic_t Quit=0;
 
-void RRH(CPU* c, MMU* m)
+static void quit(int sig)
 {
-	RRr(c,m,&c->reg.H);
-	CYCLES(8);
+	Quit=1;
 }
 
-void RRL(CPU* c, MMU* m)
+/* Runs until SIGINT or SIGTERM, then ejects so the save reaches the disk */
+void start(CPU* c, char* rompath, unsigned int flush_frames)
 {
-	RRr(c,m,&c->reg.L);
-	CYCLES(8);
+	MMU* m=&c->MMU;
+	mmu_init(m, &c->c, &c->ime);
+	cart_flush_every(m, flush_frames);
+	cart_load(m, rompath);
+	write_bios(m);
+	reset(c);
+	run_bios(c,m);
+#ifdef BLOCK_CACHE
+	c->blocks=block_cache_create();
+#endif
+#ifdef JIT
+	c->jit=jit_create();
+#endif
+	c->frame_over=0;
+	signal(SIGINT, quit);
+	signal(SIGTERM, quit);
+	while(!Quit)
+	{
+#ifdef FUSION_STATS
+		run_cycles(c, FUSION_REPORT_CYCLES);
+		block_cache_report(c->blocks);
+#else
+		run_frame(c);
+#endif
+	}
+	cart_eject(m);
+	cart_wait();
+#ifdef BLOCK_CACHE
+	block_cache_destroy(c->blocks);
+#endif
+#ifdef JIT
+	jit_destroy(c->jit);
+#endif
 }
 
-void RRHL(CPU* c, MMU* m)
-{
-	RRr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RRAext(CPU* c, MMU* m)
-{
-	RRr(c,m,&c->reg.A);
-	CYCLES(8);
-}
-
-int SLAr(CPU* c, MMU* m, uint8_t* reg)
-{
-	RESET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	if(*reg&0x80) SET_C(c->reg.F);
-	else RESET_C(c->reg.F);
-	*reg <<= 1;
-	if(!*reg) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 8;
-}
-
-void SLAB(CPU* c, MMU* m)
-{
-	CYCLES(SLAr(c,m,&c->reg.B));
-}
-
-void SLAC(CPU* c, MMU* m)
-{
-	CYCLES(SLAr(c,m,&c->reg.C));
-}
-
-void SLAD(CPU* c, MMU* m)
-{
-	CYCLES(SLAr(c,m,&c->reg.D));
-}
-
-void SLAE(CPU* c, MMU* m)
-{
-	CYCLES(SLAr(c,m,&c->reg.E));
-}
-
-void SLAH(CPU* c, MMU* m)
-{
-	CYCLES(SLAr(c,m,&c->reg.H));
-}
-
-void SLAL(CPU* c, MMU* m)
-{
-	CYCLES(SLAr(c,m,&c->reg.L));
-}
-
-void SLAHL(CPU* c, MMU* m)
-{
-	SLAr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SLAA(CPU* c, MMU* m)
-{
-	CYCLES(SLAr(c,m,&c->reg.A));
-}
-
-int SRAr(CPU* c, MMU* m, uint8_t* reg)
-{
-	RESET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	uint8_t msb=0;
-	if(*reg&0x80) msb=0x80;
-	if(*reg&0x01) SET_C(c->reg.F);
-	else RESET_C(c->reg.F);
-	*reg >>= 1;
-	*reg |= msb;
-	if(!*reg) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 8;
-}
-
-void SRAB(CPU* c, MMU* m)
-{
-	CYCLES(SRAr(c,m,&c->reg.B));
-}
-
-void SRAC(CPU* c, MMU* m)
-{
-	CYCLES(SRAr(c,m,&c->reg.C));
-}
-
-void SRAD(CPU* c, MMU* m)
-{
-	CYCLES(SRAr(c,m,&c->reg.D));
-}
-
-void SRAE(CPU* c, MMU* m)
-{
-	CYCLES(SRAr(c,m,&c->reg.E));
-}
-
-void SRAH(CPU* c, MMU* m)
-{
-	CYCLES(SRAr(c,m,&c->reg.H));
-}
-
-void SRAL(CPU* c, MMU* m)
-{
-	CYCLES(SRAr(c,m,&c->reg.L));
-}
-
-void SRAHL(CPU* c, MMU* m)
-{
-	SRAr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SRAA(CPU* c, MMU* m)
-{
-	CYCLES(SRAr(c,m,&c->reg.A));
-}
-
-int SWAPr(CPU* c, MMU* m, uint8_t* reg)
-{
-	RESET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	RESET_C(c->reg.F);
-	uint8_t uptmp=(*reg)>>4;
-	*reg <<= 4;
-	*reg |= uptmp;
-	if(!*reg) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 8;
-}
-
-void SWAPB(CPU* c, MMU* m)
-{
-	CYCLES(SWAPr(c,m,&c->reg.B));
-}
-
-void SWAPC(CPU* c, MMU* m)
-{
-	CYCLES(SWAPr(c,m,&c->reg.C));
-}
-
-void SWAPD(CPU* c, MMU* m)
-{
-	CYCLES(SWAPr(c,m,&c->reg.D));
-}
-
-void SWAPE(CPU* c, MMU* m)
-{
-	CYCLES(SWAPr(c,m,&c->reg.E));
-}
-
-void SWAPH(CPU* c, MMU* m)
-{
-	CYCLES(SWAPr(c,m,&c->reg.H));
-}
-
-void SWAPL(CPU* c, MMU* m)
-{
-	CYCLES(SWAPr(c,m,&c->reg.L));
-}
-
-void SWAPHL(CPU* c, MMU* m)
-{
-	SWAPr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SWAPA(CPU* c, MMU* m)
-{
-	CYCLES(SWAPr(c,m,&c->reg.A));
-}
-
-int SRLr(CPU* c, MMU* m, uint8_t* reg)
-{
-	RESET_N(c->reg.F);
-	RESET_H(c->reg.F);
-	if(*reg&0x01) SET_C(c->reg.F);
-	else RESET_C(c->reg.F);
-	*reg >>= 1;
-	if(!*reg) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 8;
-}
-
-void SRLB(CPU* c, MMU* m)
-{
-	CYCLES(SRLr(c,m,&c->reg.B));
-}
-
-void SRLC(CPU* c, MMU* m)
-{
-	CYCLES(SRLr(c,m,&c->reg.C));
-}
-
-void SRLD(CPU* c, MMU* m)
-{
-	CYCLES(SRLr(c,m,&c->reg.D));
-}
-
-void SRLE(CPU* c, MMU* m)
-{
-	CYCLES(SRLr(c,m,&c->reg.E));
-}
-
-void SRLH(CPU* c, MMU* m)
-{
-	CYCLES(SRLr(c,m,&c->reg.H));
-}
-
-void SRLL(CPU* c, MMU* m)
-{
-	CYCLES(SRLr(c,m,&c->reg.L));
-}
-
-void SRLHL(CPU* c, MMU* m)
-{
-	SRLr(c,m,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SRLA(CPU* c, MMU* m)
-{
-	CYCLES(SRLr(c,m,&c->reg.A));
-}
-
-int BITr(CPU*c, MMU* m, uint8_t b, uint8_t* reg)
-{
-	RESET_N(c->reg.F);
-	SET_H(c->reg.F);
-	if(((*reg >> b) & 0x1) == 0) SET_Z(c->reg.F);
-	else RESET_Z(c->reg.F);
-	return 8;
-}
-
-void BIT0B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,0,&c->reg.B));
-}
-
-void BIT0C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,0,&c->reg.C));
-}
-
-void BIT0D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,0,&c->reg.D));
-}
-
-void BIT0E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,0,&c->reg.E));
-}
-
-void BIT0H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,0,&c->reg.H));
-}
-
-void BIT0L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,0,&c->reg.L));
-}
-
-void BIT0HL(CPU* c, MMU* m)
-{
-	BITr(c,m,0,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT0A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,0,&c->reg.A));
-}
-
-void BIT1B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,1,&c->reg.B));
-}
-
-void BIT1C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,1,&c->reg.C));
-}
-
-void BIT1D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,1,&c->reg.D));
-}
-
-void BIT1E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,1,&c->reg.E));
-}
-
-void BIT1H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,1,&c->reg.H));
-}
-
-void BIT1L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,1,&c->reg.L));
-}
-
-void BIT1HL(CPU* c, MMU* m)
-{
-	BITr(c,m,1,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT1A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,1,&c->reg.A));
-}
-
-void BIT2B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,2,&c->reg.B));
-}
-
-void BIT2C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,2,&c->reg.C));
-}
-
-void BIT2D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,2,&c->reg.D));
-}
-
-void BIT2E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,2,&c->reg.E));
-}
-
-void BIT2H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,2,&c->reg.H));
-}
-
-void BIT2L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,2,&c->reg.L));
-}
-
-void BIT2HL(CPU* c, MMU* m)
-{
-	BITr(c,m,2,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT2A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,2,&c->reg.A));
-}
-
-void BIT3B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.B));
-}
-
-void BIT3C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.C));
-}
-
-void BIT3D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.D));
-}
-
-void BIT3E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.E));
-}
-
-void BIT3H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.H));
-}
-
-void BIT3L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.L));
-}
-
-void BIT3HL(CPU* c, MMU* m)
-{
-	BITr(c,m,3,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT3A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.A));
-}
-
-void BIT4B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,4,&c->reg.B));
-}
-
-void BIT4C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,4,&c->reg.C));
-}
-
-void BIT4D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,4,&c->reg.D));
-}
-
-void BIT4E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,4,&c->reg.E));
-}
-
-void BIT4H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,4,&c->reg.H));
-}
-
-void BIT4L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,4,&c->reg.L));
-}
-
-void BIT4HL(CPU* c, MMU* m)
-{
-	BITr(c,m,4,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT4A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,3,&c->reg.A));
-}
-
-void BIT5B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,5,&c->reg.B));
-}
-
-void BIT5C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,5,&c->reg.C));
-}
-
-void BIT5D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,5,&c->reg.D));
-}
-
-void BIT5E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,5,&c->reg.E));
-}
-
-void BIT5H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,5,&c->reg.H));
-}
-
-void BIT5L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,5,&c->reg.L));
-}
-
-void BIT5HL(CPU* c, MMU* m)
-{
-	BITr(c,m,5,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT5A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,4,&c->reg.A));
-}
-
-void BIT6B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,6,&c->reg.B));
-}
-
-void BIT6C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,6,&c->reg.C));
-}
-
-void BIT6D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,6,&c->reg.D));
-}
-
-void BIT6E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,6,&c->reg.E));
-}
-
-void BIT6H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,6,&c->reg.H));
-}
-
-void BIT6L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,6,&c->reg.L));
-}
-
-void BIT6HL(CPU* c, MMU* m)
-{
-	BITr(c,m,6,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT6A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,5,&c->reg.A));
-}
-
-void BIT7B(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,7,&c->reg.B));
-}
-
-void BIT7C(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,7,&c->reg.C));
-}
-
-void BIT7D(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,7,&c->reg.D));
-}
-
-void BIT7E(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,7,&c->reg.E));
-}
-
-void BIT7H(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,7,&c->reg.H));
-}
-
-void BIT7L(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,7,&c->reg.L));
-}
-
-void BIT7HL(CPU* c, MMU* m)
-{
-	BITr(c,m,7,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void BIT7A(CPU* c, MMU* m)
-{
-	CYCLES(BITr(c,m,7,&c->reg.A));
-}
-
-int RESr(CPU* c, MMU* m, uint8_t b, uint8_t* reg)
-{
-	assert(b<=7);
-	switch(b)
-	{
-		case 0: *reg&=0xFE;break;
-		case 1: *reg&=0xFD;break;
-		case 2: *reg&=0xFB;break;
-		case 3: *reg&=0xF7;break;
-		case 4: *reg&=0xEF;break;
-		case 5: *reg&=0xDF;break;
-		case 6: *reg&=0xBF;break;
-		case 7: *reg&=0x7F;break;
-	}
-	return 8;
-}
-
-void RES0B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,0,&c->reg.B));
-}
-
-void RES0C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,0,&c->reg.C));
-}
-
-void RES0D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,0,&c->reg.D));
-}
-
-void RES0E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,0,&c->reg.E));
-}
-
-void RES0H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,0,&c->reg.H));
-}
-
-void RES0L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,0,&c->reg.L));
-}
-
-void RES0HL(CPU* c, MMU* m)
-{
-	RESr(c,m,0,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES0A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,0,&c->reg.A));
-}
-
-void RES1B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,1,&c->reg.B));
-}
-
-void RES1C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,1,&c->reg.C));
-}
-
-void RES1D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,1,&c->reg.D));
-}
-
-void RES1E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,1,&c->reg.E));
-}
-
-void RES1H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,1,&c->reg.H));
-}
-
-void RES1L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,1,&c->reg.L));
-}
-
-void RES1HL(CPU* c, MMU* m)
-{
-	RESr(c,m,1,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES1A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,1,&c->reg.A));
-}
-
-void RES2B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,2,&c->reg.B));
-}
-
-void RES2C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,2,&c->reg.C));
-}
-
-void RES2D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,2,&c->reg.D));
-}
-
-void RES2E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,2,&c->reg.E));
-}
-
-void RES2H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,2,&c->reg.H));
-}
-
-void RES2L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,2,&c->reg.L));
-}
-
-void RES2HL(CPU* c, MMU* m)
-{
-	RESr(c,m,2,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES2A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,2,&c->reg.A));
-}
-
-void RES3B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,3,&c->reg.B));
-}
-
-void RES3C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,3,&c->reg.C));
-}
-
-void RES3D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,3,&c->reg.D));
-}
-
-void RES3E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,3,&c->reg.E));
-}
-
-void RES3H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,3,&c->reg.H));
-}
-
-void RES3L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,3,&c->reg.L));
-}
-
-void RES3HL(CPU* c, MMU* m)
-{
-	RESr(c,m,3,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES3A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,3,&c->reg.A));
-}
-
-void RES4B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,4,&c->reg.B));
-}
-
-void RES4C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,4,&c->reg.C));
-}
-
-void RES4D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,4,&c->reg.D));
-}
-
-void RES4E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,4,&c->reg.E));
-}
-
-void RES4H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,4,&c->reg.H));
-}
-
-void RES4L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,4,&c->reg.L));
-}
-
-void RES4HL(CPU* c, MMU* m)
-{
-	RESr(c,m,4,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES4A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,4,&c->reg.A));
-}
-
-void RES5B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,5,&c->reg.B));
-}
-
-void RES5C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,5,&c->reg.C));
-}
-
-void RES5D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,5,&c->reg.D));
-}
-
-void RES5E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,5,&c->reg.E));
-}
-
-void RES5H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,5,&c->reg.H));
-}
-
-void RES5L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,5,&c->reg.L));
-}
-
-void RES5HL(CPU* c, MMU* m)
-{
-	RESr(c,m,5,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES5A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,5,&c->reg.A));
-}
-
-void RES6B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,6,&c->reg.B));
-}
-
-void RES6C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,6,&c->reg.C));
-}
-
-void RES6D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,6,&c->reg.D));
-}
-
-void RES6E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,6,&c->reg.E));
-}
-
-void RES6H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,6,&c->reg.H));
-}
-
-void RES6L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,6,&c->reg.L));
-}
-
-void RES6HL(CPU* c, MMU* m)
-{
-	RESr(c,m,6,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES6A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,6,&c->reg.A));
-}
-
-void RES7B(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,7,&c->reg.B));
-}
-
-void RES7C(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,7,&c->reg.C));
-}
-
-void RES7D(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,7,&c->reg.D));
-}
-
-void RES7E(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,7,&c->reg.E));
-}
-
-void RES7H(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,7,&c->reg.H));
-}
-
-void RES7L(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,7,&c->reg.L));
-}
-
-void RES7HL(CPU* c, MMU* m)
-{
-	RESr(c,m,7,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void RES7A(CPU* c, MMU* m)
-{
-	CYCLES(RESr(c,m,7,&c->reg.A));
-}
-
-int SETr(CPU* c, MMU* m, uint8_t b, uint8_t* reg)
-{
-	assert(b<=7);
-	switch(b)
-	{
-		case 0: *reg|=0x01;break;
-		case 1: *reg|=0x02;break;
-		case 2: *reg|=0x04;break;
-		case 3: *reg|=0x08;break;
-		case 4: *reg|=0x10;break;
-		case 5: *reg|=0x20;break;
-		case 6: *reg|=0x40;break;
-		case 7: *reg|=0x80;break;
-	}
-	return 8;
-}
-
-void SET0B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,0,&c->reg.B));
-}
-
-void SET0C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,0,&c->reg.C));
-}
-
-void SET0D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,0,&c->reg.D));
-}
-
-void SET0E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,0,&c->reg.E));
-}
-
-void SET0H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,0,&c->reg.H));
-}
-
-void SET0L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,0,&c->reg.L));
-}
-
-void SET0HL(CPU* c, MMU* m)
-{
-	SETr(c,m,0,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET0A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,0,&c->reg.A));
-}
-
-void SET1B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,1,&c->reg.B));
-}
-
-void SET1C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,1,&c->reg.C));
-}
-
-void SET1D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,1,&c->reg.D));
-}
-
-void SET1E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,1,&c->reg.E));
-}
-
-void SET1H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,1,&c->reg.H));
-}
-
-void SET1L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,1,&c->reg.L));
-}
-
-void SET1HL(CPU* c, MMU* m)
-{
-	SETr(c,m,1,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET1A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,1,&c->reg.A));
-}
-
-void SET2B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,2,&c->reg.B));
-}
-
-void SET2C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,2,&c->reg.C));
-}
-
-void SET2D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,2,&c->reg.D));
-}
-
-void SET2E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,2,&c->reg.E));
-}
-
-void SET2H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,2,&c->reg.H));
-}
-
-void SET2L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,2,&c->reg.L));
-}
-
-void SET2HL(CPU* c, MMU* m)
-{
-	SETr(c,m,2,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET2A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,2,&c->reg.A));
-}
-
-void SET3B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,3,&c->reg.B));
-}
-
-void SET3C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,3,&c->reg.C));
-}
-
-void SET3D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,3,&c->reg.D));
-}
-
-void SET3E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,3,&c->reg.E));
-}
-
-void SET3H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,3,&c->reg.H));
-}
-
-void SET3L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,3,&c->reg.L));
-}
-
-void SET3HL(CPU* c, MMU* m)
-{
-	SETr(c,m,3,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET3A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,3,&c->reg.A));
-}
-
-void SET4B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,4,&c->reg.B));
-}
-
-void SET4C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,4,&c->reg.C));
-}
-
-void SET4D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,4,&c->reg.D));
-}
-
-void SET4E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,4,&c->reg.E));
-}
-
-void SET4H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,4,&c->reg.H));
-}
-
-void SET4L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,4,&c->reg.L));
-}
-
-void SET4HL(CPU* c, MMU* m)
-{
-	SETr(c,m,4,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET4A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,4,&c->reg.A));
-}
-
-void SET5B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,5,&c->reg.B));
-}
-
-void SET5C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,5,&c->reg.C));
-}
-
-void SET5D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,5,&c->reg.D));
-}
-
-void SET5E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,5,&c->reg.E));
-}
-
-void SET5H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,5,&c->reg.H));
-}
-
-void SET5L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,5,&c->reg.L));
-}
-
-void SET5HL(CPU* c, MMU* m)
-{
-	SETr(c,m,5,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET5A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,5,&c->reg.A));
-}
-
-void SET6B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,6,&c->reg.B));
-}
-
-void SET6C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,6,&c->reg.C));
-}
-
-void SET6D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,6,&c->reg.D));
-}
-
-void SET6E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,6,&c->reg.E));
-}
-
-void SET6H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,6,&c->reg.H));
-}
-
-void SET6L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,6,&c->reg.L));
-}
-
-void SET6HL(CPU* c, MMU* m)
-{
-	SETr(c,m,6,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET6A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,6,&c->reg.A));
-}
-
-void SET7B(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,7,&c->reg.B));
-}
-
-void SET7C(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,7,&c->reg.C));
-}
-
-void SET7D(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,7,&c->reg.D));
-}
-
-void SET7E(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,7,&c->reg.E));
-}
-
-void SET7H(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,7,&c->reg.H));
-}
-
-void SET7L(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,7,&c->reg.L));
-}
-
-void SET7HL(CPU* c, MMU* m)
-{
-	SETr(c,m,7,&m[WORD(c->reg.H, c->reg.L)]);
-	CYCLES(16);
-}
-
-void SET7A(CPU* c, MMU* m)
-{
-	CYCLES(SETr(c,m,7,&c->reg.A));
-}
-
-void execute_next(CPU* c, MMU* m)
-{
-	OpCodes[m[c->PC++]](c,m);
-}
-
-void reset(CPU* c)
-{
-	c->reg.A=c->reg.B=c->reg.C=c->reg.D=c->reg.E=c->reg.H=c->reg.L=c->reg.F=c->PC=0;
-	c->SP=0xFFFE;
-}
-
-static void write_bios(MMU* m)
-{
-	int i;
-	for(i=0; i<256; ++i)
-	{
-		m[i]=Bios[i];
-	}
-}
-
-static void run_bios(CPU* c, MMU* m)
-{
-	while(c->PC!=256)
-	{
-		printf("BIOS: 0x%x, PC: %d\n", m[c->PC], c->PC);
-		execute_next(c,m);
-	}
-	memset(m, 0, 256); // Clear bios from memory
-}
-
-static void load_rom(char* path, MMU* m)
-{
-	FILE* f=fopen(path, "r");
-	if(!f)
-	{
-		fprintf(stderr, "Failed to open rom: %s\n", path);
-		exit(EXIT_FAILURE);
-	}
-	unsigned b=0;
-	while(fread(&m[b], 1, 1, f) > 0) ++b;
-	fclose(f);
-}
-
-void start(CPU* c, char* rompath)
-{
-	MMU* m=c->MMU;
-	load_rom(rompath, m);
-	write_bios(m);
-	reset(c);
-	run_bios(c,m);
-	load_rom(rompath, m);
-	while(1)
-	{
-		execute_next(c,m);
-	}
-}
-
-int main(int argc, char** argv)
+int main(int argc, char** argv)
 {
+	Arena* a;
+	CPU* c;
+#ifdef SELF_CHECK
+	/* Debug build: check the tables against the handlers instead of running */
+	cpu_check();
+	printf("Self check passed\n");
+	return 0;
+#endif
+#ifdef BENCHMARK
+	benchmark();
+	return 0;
+#endif
 	if(argc<2)
 	{
 		printf("Please specify a rom file\n");
 		exit(EXIT_SUCCESS);
 	}
-	CPU cpu;
-	start(&cpu, argv[1]);
+	a=arena_create(1);
+	c=arena_alloc(a);
+	/* Frames between writebacks of the save file, 0 leaves them to the kernel */
+	start(c, argv[1], argc>2 ? strtoul(argv[2], 0, 10) : SAVE_FLUSH_DEFAULT);
+	arena_free(a, c);
+	arena_destroy(a);
 	return 0;
 }
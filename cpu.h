@@ -2,6 +2,7 @@
 #define TAPIBOYCPU
 
 #include <stdint.h>
+#include "mmu.h"
 
 #define ZERO		0x80 /* Z - Last math operation is zero or two values match when using CP */
 #define SUBTRACT	0x40 /* N - Subtraction was performed in the last math instruction */
@@ -10,17 +11,19 @@
 
 #define ROM_START 0x100 /* Rom starting location in memory */
 
-typedef uint8_t MMU;
+/* 8 bit registers that can also be used as the 16 bit pair hi##lo */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define Z80_PAIR(hi, lo) union { struct { uint8_t hi; uint8_t lo; }; uint16_t hi##lo; }
+#else
+#define Z80_PAIR(hi, lo) union { struct { uint8_t lo; uint8_t hi; }; uint16_t hi##lo; }
+#endif
+
 typedef struct Z80_8BitRegisters
 {
-	uint8_t A;
-	uint8_t B;
-	uint8_t C;
-	uint8_t D;
-	uint8_t E;
-	uint8_t H;
-	uint8_t L;
-	uint8_t F; /* Flags register */
+	Z80_PAIR(A, F); /* F is the flags register */
+	Z80_PAIR(B, C);
+	Z80_PAIR(D, E);
+	Z80_PAIR(H, L);
 } Z80Reg;
 
 typedef struct Z80CPU
@@ -34,12 +37,74 @@ typedef struct Z80CPU
 
 	uint8_t halt; /* Is the CPU halted? */
 	uint8_t stop; /* Is the CPU stopped? */
-	unsigned int c; /* Total time in clock cycles (*4 of machine cycles) */
-	MMU MMU[65536];
+	uint64_t c; /* Clock cycles since power on (*4 of machine cycles), 64 bits never wrap */
+	unsigned int frame_over; /* Cycles the last run_frame ran past its frame */
+	uint64_t halted; /* Cycles skipped over in HALT, also counted in c */
+#ifdef BLOCK_CACHE
+	struct BlockCache* blocks; /* Predecoded code, see cpu.c */
+#endif
+#ifdef JIT
+	struct Jit* jit; /* Compiled code, see jit.c */
+#endif
+	MMU MMU;
 } CPU;
 
 typedef void(*OpCode)(CPU*, MMU*);
 
+#define FRAME_CYCLES 70224 /* 154 lines of 456 cycles */
+
+/*
+ * Entry points for embedding the core. Each returns the cycles it ran
+ * minus budget: the overshoot past the last instruction boundary, or a
+ * negative value when run_until_pc reached pc first. run_frame runs one
+ * frame, shortened by the overshoot of the previous one, and counts it
+ * towards the next writeback of the save file. c counts every
+ * cycle since power on and is the timebase events are scheduled on.
+ */
+int64_t run_cycles(CPU* c, uint64_t budget);
+int64_t run_until_pc(CPU* c, uint16_t pc, uint64_t budget);
+int64_t run_frame(CPU* c);
+
+#define BREAK_NONE 0x10000 /* Breakpoint of the block cores outside run_until_pc */
+
+#if defined(BLOCK_CACHE) && !defined(THREADED_DISPATCH)
+#error "BLOCK_CACHE runs on top of THREADED_DISPATCH"
+#endif
+
+#if defined(ALU_TABLES) && !defined(THREADED_DISPATCH)
+#error "ALU_TABLES is a mode of THREADED_DISPATCH"
+#endif
+
+#if defined(LAZY_FLAGS) && !defined(THREADED_DISPATCH)
+#error "LAZY_FLAGS is a mode of THREADED_DISPATCH"
+#endif
+
+#if defined(FUSION_STATS) && !defined(BLOCK_CACHE)
+#error "FUSION_STATS counts fusions done by BLOCK_CACHE"
+#endif
+
+#if defined(CB_DECODE) && defined(THREADED_DISPATCH)
+#error "CB_DECODE is a mode of the table interpreter"
+#endif
+
+#if defined(JIT) && defined(THREADED_DISPATCH)
+#error "JIT and THREADED_DISPATCH are alternative cores"
+#endif
+
+#ifdef THREADED_DISPATCH
+/* Computed-goto interpreter core, see cpu.c */
+uint64_t run_threaded(CPU* c, MMU* m, uint64_t budget);
+#ifdef BLOCK_CACHE
+struct BlockCache* block_cache_create(void);
+void block_cache_flush(struct BlockCache* bc);
+void block_cache_destroy(struct BlockCache* bc);
+#ifdef FUSION_STATS
+#define FUSION_REPORT_CYCLES (1<<24) /* Cycles between reports in start() */
+void block_cache_report(struct BlockCache* bc);
+#endif
+#endif
+#endif
+
 void NOP(CPU* c, MMU* m);
 void LDBCnn(CPU* c, MMU* m);
 void LDBCA(CPU* c, MMU* m);
@@ -573,42 +638,42 @@ void SET7L(CPU* c, MMU* m);
 void SET7HL(CPU* c, MMU* m);
 void SET7A(CPU* c, MMU* m);
 
-OpCode OpCodes[256]={
-    &NOP, &LDBCnn, &LDBCA, &INCBC, &INCB, &DECB, &LDBn, &RLCA, &LDnnSP, &ADDHLBC, &LDABC, &DECBC, &INCC, &DECC, &LDCn, &RRCA,
-    &STOP, &LDDEnn, &LDDEA, &INCDE, &INCD, &DECD, &LDDn, &RLA, &JRn, &ADDHLDE, &LDADE, &DECDE, &INCE, &DECE, &LDEn, &RRA,
-    &JRNZn, &LDHLnn, &LDIHLA, &INCHL, &INCH, &DECH, &LDHn, &DAA, &JRZn, &ADDHLHL, &LDIAHL, &DECHL, &INCL, &DECL, &LDLn, &CPL,
-    &JRNCn, &LDSPnn, &LDDHLA, &INCSP, &INCHL2, &DECHL2, &LDHLn, &SCF, &JRCn, &ADDHLSP, &LDDAHL, &DECSP, &INCA, &DECA, &LDAn, &CCF, 
-    &LDBB, &LDBC, &LDBD, &LDBE, &LDBH, &LDBL, &LDBHL, &LDBA, &LDCB, &LDCC, &LDCD, &LDCE, &LDCH, &LDCL, &LDCHL, &LDCA, 
-    &LDDB, &LDDC, &LDDD, &LDDE, &LDDH, &LDDL, &LDDHL, &LDDA, &LDEB, &LDEC, &LDED, &LDEE, &LDEH, &LDEL, &LDEHL, &LDEA, 
-    &LDHB, &LDHC, &LDHD, &LDHE, &LDHH, &LDHL, &LDHHL, &LDHA, &LDLB, &LDLC, &LDLD, &LDLE, &LDLH, &LDLL, &LDLHL, &LDLA, 
-    &LDHLB, &LDHLC, &LDHLD, &LDHLE, &LDHLH, &LDHLL, &HALT, &LDHLA, &LDAB, &LDAC, &LDAD, &LDAE, &LDAH, &LDAL, &LDAHL, &LDAA, 
-    &ADDAB, &ADDAC, &ADDAD, &ADDAE, &ADDAH, &ADDAL, &ADDAHL, &ADDAA, &ADCAB, &ADCAC, &ADCAD, &ADCAE, &ADCAH, &ADCAL, &ADCAHL, &ADCAA, 
-    &SUBAB, &SUBAC, &SUBAD, &SUBAE, &SUBAH, &SUBAL, &SUBAHL, &SUBAA, &SBCAB, &SBCAC, &SBCAD, &SBCAE, &SBCAH, &SBCAL, &SBCAHL, &SBCAA, 
-    &ANDB, &ANDC, &ANDD, &ANDE, &ANDH, &ANDL, &ANDHL, &ANDA, &XORB, &XORC, &XORD, &XORE, &XORH, &XORL, &XORHL, &XORA, 
-    &ORB, &ORC, &ORD, &ORE, &ORH, &ORL, &ORHL, &ORA, &CPB, &CPC, &CPD, &CPE, &CPH, &CP_L, &CPHL, &CPA, 
-    &RETNZ, &POPBC, &JPNZnn, &JPnn, &CALLNZnn, &PUSHBC, &ADDAn, &RST0, &RETZ, &RET, &JPZnn, &Extops, &CALLZnn, &CALLnn, &ADCAn, &RST8, 
-    &RETNC, &POPDE, &JPNCnn, 0, &CALLNCnn, &PUSHDE, &SUBAn, &RST10, &RETC, &RETI, &JPCnn, 0, &CALLCnn, 0, &SBCAn, &RST18, 
-    &LDHnA, &POPHL, &LDHCA, 0, 0, &PUSHHL, &ANDn, &RST20, &ADDSPd, &JPHL, &LDnnA, 0, 0, 0, &XORn, &RST28, 
-    &LDHAn, &POPAF, 0, &DI, 0, &PUSHAF, &ORn, &RST30, &LDHLSPd, &LDSPHL, &LDAnn, &EI, 0, 0, &CPn, &RST38
-};
-
-OpCode ExtOps[256]={
-	&RLCB, &RLCC, &RLCD, &RLCE, &RLCH, &RLCL, &RLCHL, &RLCAext, &RRCB, &RRCC, &RRCD, &RRCE, &RRCH, &RRCL, &RRCHL, &RRCAext,
-	&RLB, &RLC, &RLD, &RLE, &RLH, &RLL, &RLHL, &RLAext, &RRB, &RRC, &RRD, &RRE, &RRH, &RRL, &RRHL, &RRAext,
-	&SLAB, &SLAC, &SLAD, &SLAE, &SLAH, &SLAL, &SLAHL, &SLAA, &SRAB, &SRAC, &SRAD, &SRAE, &SRAH, &SRAL, &SRAHL, &SRAA,
-	&SWAPB, &SWAPC, &SWAPD, &SWAPE, &SWAPH, &SWAPL, &SWAPHL, &SWAPA, &SRLB, &SRLC, &SRLD, &SRLE, &SRLH, &SRLL, &SRLHL, &SRLA,
-	&BIT0B, &BIT0C, &BIT0D, &BIT0E, &BIT0H, &BIT0L, &BIT0HL, &BIT0A, &BIT1B, &BIT1C, &BIT1D, &BIT1E, &BIT1H, &BIT1L, &BIT1HL, &BIT1A,
-	&BIT2B, &BIT2C, &BIT2D, &BIT2E, &BIT2H, &BIT2L, &BIT2HL, &BIT2A, &BIT3B, &BIT3C, &BIT3D, &BIT3E, &BIT3H, &BIT3L, &BIT3HL, &BIT3A,
-	&BIT4B, &BIT4C, &BIT4D, &BIT4E, &BIT4H, &BIT4L, &BIT4HL, &BIT4A, &BIT5B, &BIT5C, &BIT5D, &BIT5E, &BIT5H, &BIT5L, &BIT5HL, &BIT5A,
-	&BIT6B, &BIT6C, &BIT6D, &BIT6E, &BIT6H, &BIT6L, &BIT6HL, &BIT6A, &BIT7B, &BIT7C, &BIT7D, &BIT7E, &BIT7H, &BIT7L, &BIT7HL, &BIT7A,
-	&RES0B, &RES0C, &RES0D, &RES0E, &RES0H, &RES0L, &RES0HL, &RES0A, &RES1B, &RES1C, &RES1D, &RES1E, &RES1H, &RES1L, &RES1HL, &RES1A,
-	&RES2B, &RES2C, &RES2D, &RES2E, &RES2H, &RES2L, &RES2HL, &RES2A, &RES3B, &RES3C, &RES3D, &RES3E, &RES3H, &RES3L, &RES3HL, &RES3A,
-	&RES4B, &RES4C, &RES4D, &RES4E, &RES4H, &RES4L, &RES4HL, &RES4A, &RES5B, &RES5C, &RES5D, &RES5E, &RES5H, &RES5L, &RES5HL, &RES5A,
-	&RES6B, &RES6C, &RES6D, &RES6E, &RES6H, &RES6L, &RES6HL, &RES6A, &RES7B, &RES7C, &RES7D, &RES7E, &RES7H, &RES7L, &RES7HL, &RES7A,
-	&SET0B, &SET0C, &SET0D, &SET0E, &SET0H, &SET0L, &SET0HL, &SET0A, &SET1B, &SET1C, &SET1D, &SET1E, &SET1H, &SET1L, &SET1HL, &SET1A,
-	&SET2B, &SET2C, &SET2D, &SET2E, &SET2H, &SET2L, &SET2HL, &SET2A, &SET3B, &SET3C, &SET3D, &SET3E, &SET3H, &SET3L, &SET3HL, &SET3A,
-	&SET4B, &SET4C, &SET4D, &SET4E, &SET4H, &SET4L, &SET4HL, &SET4A, &SET5B, &SET5C, &SET5D, &SET5E, &SET5H, &SET5L, &SET5HL, &SET5A,
-	&SET6B, &SET6C, &SET6D, &SET6E, &SET6H, &SET6L, &SET6HL, &SET6A, &SET7B, &SET7C, &SET7D, &SET7E, &SET7H, &SET7L, &SET7HL, &SET7A
-};
+extern OpCode OpCodes[256];
+extern OpCode ExtOps[256];
+void CBdecode(CPU* c, MMU* m, uint8_t op); /* -DCB_DECODE, replaces ExtOps[] in Extops */
+
+/* Operand that follows the opcode byte */
+enum { OPND_NONE, OPND_IMM8, OPND_IMM16, OPND_REL8, OPND_SIMM8, OPND_CB };
+/* How the instruction affects the flow of control */
+enum { FLOW_NONE, FLOW_JUMP, FLOW_STOP };
+
+typedef struct OpInfo
+{
+	const char* name; /* Mnemonic, 0 for the undefined opcodes */
+	uint8_t len; /* Length in bytes, CB ops count 2 */
+	uint8_t cycles; /* Clock cycles, not taken for conditional ops */
+	uint8_t taken; /* Clock cycles when the branch is taken, 0 if unconditional */
+	uint8_t operand; /* OPND_* */
+	uint8_t flags_read; /* Flags the result depends on */
+	uint8_t flags_written; /* Flags the instruction may change */
+	uint8_t flow; /* FLOW_* */
+} OpInfo;
+
+/* Opcode metadata, the dispatch charges cycles from here. The T_OP lines of the threaded core repeat them, keep those in sync. */
+extern const OpInfo OpInfos[256];
+extern const OpInfo ExtOpInfos[256];
+
+#if defined(ALU_TABLES) || defined(JIT)
+/* Result<<8|flags of the ALU helpers for every input, see alu_tables_init */
+extern uint16_t AluAdd[256*256];
+extern uint16_t AluSub[256*256];
+extern uint16_t AluSbc[256*256];
+extern uint8_t AluCp[256*256];
+extern uint8_t AluInc[256];
+extern uint8_t AluDec[256];
+extern uint16_t AluDaa[256*8];
+void alu_tables_init(void);
+#endif
+void execute_next(CPU* c, MMU* m);
 
 #endif
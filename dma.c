@@ -0,0 +1,145 @@
+#include <string.h>
+#include "dma.h"
+#include "sched.h"
+
+#define OAM 0xFE00
+#define OAM_SIZE 0xA0
+#define OAM_CYCLES 640 /* 160 machine cycles */
+#define VRAM 0x8000
+#define VRAM_SIZE 0x2000
+#define LINE_CYCLES 456
+#define HBLANK_AT 252 /* Cycles into a line when mode 0 starts */
+#define HDMA_BLOCK 16
+#define HDMA_CYCLES 32 /* The CPU is stopped for 8 machine cycles per block */
+
+/* len bytes from src as the CPU sees it, a page at a time */
+static void dma_copy(MMU* m, uint8_t* dst, uint16_t src, unsigned int len)
+{
+	while(len)
+	{
+		const uint8_t* p=m->rd[src>>PAGE_SHIFT];
+		unsigned int n=PAGE_SIZE-(src&(PAGE_SIZE-1));
+		unsigned int i;
+		if(n > len) n=len;
+		if(p) memcpy(dst, p+(src&(PAGE_SIZE-1)), n);
+		else for(i=0; i<n; ++i) dst[i]=mmu_read_io(m, src+i);
+		dst+=n;
+		src+=n;
+		len-=n;
+	}
+}
+
+/*
+ * OAM DMA copies all 160 bytes when it is started and takes the OAM pages
+ * out of the page table. Until its event puts them back 640 cycles later
+ * the CPU reads FF there and its writes are lost.
+ */
+static uint8_t oam_read(MMU* m, uint16_t addr)
+{
+	return 0xFF;
+}
+
+static void oam_write(MMU* m, uint16_t addr, uint8_t val)
+{
+}
+
+void dma_oam_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	REG(addr)=val;
+	dma_copy(m, &REG(OAM), val<<8, OAM_SIZE);
+	mmu_map(m, OAM, 0x100, 0, 0);
+	sched_add(m, EV_OAM_DMA, *m->clock+OAM_CYCLES);
+#ifdef DIRTY_PAGES
+	mmu_mark(m, OAM);
+#endif
+}
+
+void dma_oam_end(MMU* m, uint64_t when)
+{
+	mmu_map(m, OAM, 0x100, &REG(OAM), &REG(OAM));
+}
+
+/* Blocks of 16 bytes, the destination wraps inside VRAM */
+static void hdma_copy(MMU* m, unsigned int blocks)
+{
+	Dma* d=&m->dma;
+	while(blocks--)
+	{
+		uint16_t dst=VRAM|(d->hdma_dst&(VRAM_SIZE-1));
+		dma_copy(m, &REG(dst), d->hdma_src, HDMA_BLOCK);
+#ifdef DIRTY_PAGES
+		mmu_mark(m, dst);
+#endif
+		d->hdma_src+=HDMA_BLOCK;
+		d->hdma_dst+=HDMA_BLOCK;
+	}
+}
+
+/* First H-blank after clock. There is no LCD yet, so lines run from clock 0 */
+static uint64_t hdma_next(uint64_t clock)
+{
+	uint64_t hblank=clock-clock%LINE_CYCLES+HBLANK_AT;
+	return hblank > clock ? hblank : hblank+LINE_CYCLES;
+}
+
+/* hdma5 is what HDMA5 reads from then on */
+static void hdma_stop(MMU* m, uint8_t hdma5)
+{
+	m->dma.hdma_on=0;
+	REG(0xFF55)=hdma5;
+	sched_cancel(m, EV_HDMA);
+}
+
+/* One block per H-blank with the CPU stopped while it is copied */
+void hdma_hblank(MMU* m, uint64_t when)
+{
+	Dma* d=&m->dma;
+	hdma_copy(m, 1);
+	*m->clock+=HDMA_CYCLES;
+	if(--d->hdma_left) sched_add(m, EV_HDMA, when+LINE_CYCLES);
+	else hdma_stop(m, 0xFF);
+}
+
+void hdma_reg_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	REG(addr)=val;
+}
+
+/* Blocks left minus one while a transfer runs, bit 7 set once it is done or stopped */
+uint8_t hdma_read(MMU* m, uint16_t addr)
+{
+	if(m->dma.hdma_on) return m->dma.hdma_left-1;
+	return REG(addr);
+}
+
+void hdma_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	Dma* d=&m->dma;
+	if(d->hdma_on && !(val&0x80))
+	{
+		/* Stops the H-blank transfer */
+		hdma_stop(m, 0x80|(d->hdma_left-1));
+		return;
+	}
+	d->hdma_src=(REG(0xFF51)<<8)|(REG(0xFF52)&0xF0);
+	d->hdma_dst=VRAM|((REG(0xFF53)&0x1F)<<8)|(REG(0xFF54)&0xF0);
+	d->hdma_left=(val&0x7F)+1;
+	if(val&0x80)
+	{
+		d->hdma_on=1;
+		sched_add(m, EV_HDMA, hdma_next(*m->clock));
+	}
+	else
+	{
+		/* General purpose, all at once with the CPU stopped */
+		*m->clock+=d->hdma_left*HDMA_CYCLES;
+		hdma_copy(m, d->hdma_left);
+		d->hdma_left=0;
+		REG(addr)=0xFF;
+	}
+}
+
+void dma_init(MMU* m)
+{
+	mmu_map_io(m, OAM, 0x100, oam_read, oam_write);
+}
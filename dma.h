@@ -0,0 +1,19 @@
+#ifndef TAPIBOYDMA
+#define TAPIBOYDMA
+
+#include "mmu.h"
+
+/*
+ * OAM DMA and CGB HDMA. Transfers are bulk copies through the page table;
+ * OAM is taken out of the page table while its transfer runs, and an
+ * H-blank transfer copies a block from its event on every line.
+ */
+void dma_init(MMU* m);
+void dma_oam_write(MMU* m, uint16_t addr, uint8_t val);
+void dma_oam_end(MMU* m, uint64_t when); /* EV_OAM_DMA */
+void hdma_hblank(MMU* m, uint64_t when); /* EV_HDMA */
+void hdma_reg_write(MMU* m, uint16_t addr, uint8_t val);
+uint8_t hdma_read(MMU* m, uint16_t addr);
+void hdma_write(MMU* m, uint16_t addr, uint8_t val);
+
+#endif
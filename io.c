@@ -0,0 +1,103 @@
+#include "io.h"
+#include "cart.h"
+#include "dma.h"
+#include "timer.h"
+#include "irq.h"
+
+typedef struct IoReg
+{
+	MemRead rd; /* 0 reads mem */
+	MemWrite wr; /* 0 writes mem */
+} IoReg;
+
+/* P14 low selects the directions, P15 the buttons, a pressed key reads 0 */
+static uint8_t joyp_read(MMU* m, uint16_t addr)
+{
+	uint8_t sel=REG(addr)&0x30;
+	uint8_t v=0x0F;
+	if(!(sel&0x10)) v&=~m->keys;
+	if(!(sel&0x20)) v&=~(m->keys>>4);
+	return 0xC0|sel|v;
+}
+
+static void joyp_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	REG(addr)=val&0x30;
+}
+
+static uint8_t tac_read(MMU* m, uint16_t addr)
+{
+	return 0xF8|REG(addr);
+}
+
+static uint8_t if_read(MMU* m, uint16_t addr)
+{
+	return 0xE0|REG(addr);
+}
+
+/* The mode and coincidence bits belong to the LCD */
+static uint8_t stat_read(MMU* m, uint16_t addr)
+{
+	return 0x80|REG(addr);
+}
+
+static void stat_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	REG(addr)=(REG(addr)&0x07)|(val&0x78);
+}
+
+static void read_only(MMU* m, uint16_t addr, uint8_t val)
+{
+}
+
+static uint8_t write_only(MMU* m, uint16_t addr)
+{
+	return 0xFF;
+}
+
+/* Writing 1 takes the boot ROM off the start of the cartridge */
+static void boot_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	REG(addr)=val;
+	if((val&1) && m->cart.rom) cart_remap(m);
+}
+
+static const IoReg IoRegs[IO_REGS]={
+	[0x00]={joyp_read, joyp_write}, /* JOYP */
+	[0x04]={div_read, div_write}, /* DIV */
+	[0x05]={tima_read, tima_write}, /* TIMA */
+	[0x06]={0, tma_write}, /* TMA */
+	[0x07]={tac_read, tac_write}, /* TAC */
+	[0x0F]={if_read, irq_write}, /* IF */
+	[0x41]={stat_read, stat_write}, /* STAT */
+	[0x44]={0, read_only}, /* LY */
+	[0x46]={0, dma_oam_write}, /* DMA */
+	[0x50]={0, boot_write}, /* BOOT */
+	[0x51]={write_only, hdma_reg_write}, /* HDMA1-4, source and destination */
+	[0x52]={write_only, hdma_reg_write},
+	[0x53]={write_only, hdma_reg_write},
+	[0x54]={write_only, hdma_reg_write},
+	[0x55]={hdma_read, hdma_write} /* HDMA5, length and start */
+};
+
+static uint8_t io_read(MMU* m, uint16_t addr)
+{
+	const IoReg* r=&IoRegs[addr-IO_BASE];
+	return r->rd ? r->rd(m, addr) : REG(addr);
+}
+
+static void io_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	const IoReg* r=&IoRegs[addr-IO_BASE];
+	if(r->wr) r->wr(m, addr, val);
+	else REG(addr)=val;
+}
+
+void io_init(MMU* m)
+{
+	mmu_map(m, IO_BASE, IO_REGS, 0, 0);
+	mmu_map_io(m, IO_BASE, IO_REGS, io_read, io_write);
+	dma_init(m);
+	timer_init(m);
+	irq_init(m);
+}
@@ -0,0 +1,26 @@
+#ifndef TAPIBOYIO
+#define TAPIBOYIO
+
+#include "mmu.h"
+
+#define IO_BASE 0xFF00
+#define IO_REGS 0x80
+
+/* Bits of MMU.keys */
+#define KEY_RIGHT	0x01
+#define KEY_LEFT	0x02
+#define KEY_UP		0x04
+#define KEY_DOWN	0x08
+#define KEY_A		0x10
+#define KEY_B		0x20
+#define KEY_SELECT	0x40
+#define KEY_START	0x80
+
+/*
+ * I/O registers at FF00-FF7F. Their page has no pointer, so only accesses
+ * to it go through the per-register handlers in io.c. A register without
+ * a handler is plain memory in mem.
+ */
+void io_init(MMU* m);
+
+#endif
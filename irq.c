@@ -0,0 +1,57 @@
+#include "irq.h"
+#include "sched.h"
+
+#define IF 0xFF0F
+#define IE MMU_IE
+#define INT_MASK 0x1F
+#define INT_VECTOR 0x40 /* Handlers are 8 bytes apart from here, in bit order */
+
+void irq_update(MMU* m)
+{
+	m->irq=*m->ime && (REG(IE)&REG(IF)&INT_MASK);
+	sched_update(m);
+}
+
+void irq_request(MMU* m, uint8_t bits)
+{
+	REG(IF)|=bits;
+#ifdef DIRTY_PAGES
+	mmu_mark(m, IF);
+#endif
+	irq_update(m);
+}
+
+uint16_t irq_take(MMU* m)
+{
+	int bit=__builtin_ctz(REG(IE)&REG(IF)&INT_MASK);
+	REG(IF)&=~(1<<bit);
+#ifdef DIRTY_PAGES
+	mmu_mark(m, IF);
+#endif
+	*m->ime=0;
+	irq_update(m);
+	return INT_VECTOR+bit*8;
+}
+
+int irq_waiting(MMU* m)
+{
+	return REG(IE)&REG(IF)&INT_MASK;
+}
+
+/* EI takes effect after the instruction that follows it */
+void irq_ei(MMU* m, uint64_t when)
+{
+	*m->ime=1;
+	irq_update(m);
+}
+
+void irq_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	REG(addr)=val;
+	irq_update(m);
+}
+
+void irq_init(MMU* m)
+{
+	irq_update(m);
+}
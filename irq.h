@@ -0,0 +1,27 @@
+#ifndef TAPIBOYIRQ
+#define TAPIBOYIRQ
+
+#include "mmu.h"
+
+/* Bits of IE and IF, the lowest set bit wins */
+#define INT_VBLANK 0x01
+#define INT_STAT 0x02
+#define INT_TIMER 0x04
+#define INT_SERIAL 0x08
+#define INT_JOYPAD 0x10
+
+/*
+ * IE, IF and IME. Whether an interrupt is due is worked out again only
+ * when one of them changes, and kept in m->irq. While it is set
+ * sched.next stays 0, so the run loops find it with the compare they
+ * already do for events and take it between two instructions.
+ */
+void irq_init(MMU* m);
+void irq_update(MMU* m); /* After IE, IF or IME changed */
+void irq_request(MMU* m, uint8_t bits);
+uint16_t irq_take(MMU* m); /* Acknowledges the interrupt and returns its vector */
+int irq_waiting(MMU* m); /* An enabled interrupt is requested, IME or not, which ends HALT */
+void irq_ei(MMU* m, uint64_t when); /* EV_EI */
+void irq_write(MMU* m, uint16_t addr, uint8_t val); /* IF from io.c, IE from mmu_write_io */
+
+#endif
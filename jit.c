@@ -0,0 +1,771 @@
+#ifdef JIT
+#ifndef __x86_64__
+#error "The JIT emits x86-64 code"
+#endif
+
+#define _GNU_SOURCE /* memfd_create */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "jit.h"
+
+/*
+ * Hot blocks are translated into x86-64 functions of the form
+ * void fn(CPU* c, MMU* m). Register moves, loads, stores, 16 bit inc/dec,
+ * jumps, the 8 bit ALU ops and BIT/RES/SET on registers are emitted
+ * natively and work directly on the CPU struct; loads and stores look up
+ * the page table and fall back to the handler on I/O pages and IE. The
+ * ALU ops take their result and flags from the tables alu_tables_init
+ * fills from the helpers, so they match them bit for bit. Everything else
+ * is compiled into a call to its OpCodes[]/ExtOps[] handler with c->PC
+ * set up the way execute_next would leave it, so the interpreter stays
+ * the reference for all semantics. Code that is not hot yet runs in the
+ * interpreter up to its next jump, so blocks start at jump targets.
+ *
+ * Instructions add their OpInfos cycles at compile time, the sum is
+ * written to c->c around every handler call and at the block exit, so the
+ * cycle count is exact whenever control leaves compiled code.
+ *
+ * A block only runs when it ends before the next scheduled event, so
+ * events fire on the same instruction as in the interpreter. A handler
+ * can bring sched.next forward, by scheduling an event, requesting an
+ * interrupt or with EI, so the block keeps the sched.next it was entered
+ * with and returns after any call that changed it. A jump back to the
+ * start of the block loops in compiled code under the same check
+ * jit_execute makes before calling it.
+ *
+ * Stores mark their page in m->jit_dirty. Before a block runs from a
+ * marked page, every block on it is compared with the guest bytes it was
+ * compiled from, the changed ones are dropped and the mark is cleared.
+ * Blocks also remember the page pointer they were compiled from, so a
+ * bank switch is caught without a store to the code. A block that
+ * stores into its own page returns right after the store, so the next
+ * instruction is checked like any other entry.
+ *
+ * The code buffer is mapped twice, read-write where blocks are emitted
+ * and read-execute where they run, so no page is ever both writable and
+ * executable and compiling a block needs no system call.
+ */
+
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 64 /* Hits on a PC before its block gets compiled */
+#endif
+#define JIT_SLOTS 1024 /* Compiled blocks, direct mapped on the low bits of PC */
+#define JIT_HITS 4096 /* Hit counters, hashed on the low bits of PC */
+#define JIT_MAX_OPS 32 /* Instructions per block */
+#define JIT_MAX_BYTES 64 /* Guest bytes per block */
+#define JIT_OP_CODE 256 /* Upper bound of host code per instruction */
+#define JIT_BLOCK_CODE (JIT_MAX_OPS*JIT_OP_CODE+64)
+#define JIT_BUFFER (1<<20)
+#define JIT_INVALID 0x10000
+
+typedef void(*JitFn)(CPU*, MMU*);
+
+typedef struct JitBlock
+{
+	uint32_t pc;
+	uint16_t len;
+	uint16_t cycles; /* Most the block can take, taken branches and all */
+	const uint8_t* base; /* Page the block was compiled from, a bank switch repoints it */
+	uint8_t code[JIT_MAX_BYTES]; /* Guest bytes the block was compiled from */
+	JitFn fn;
+} JitBlock;
+
+struct Jit
+{
+	JitBlock slot[JIT_SLOTS];
+	uint8_t hits[JIT_HITS];
+	uint64_t starts[0x10000>>6]; /* PCs blocks were compiled at, so a page check skips the empty slots */
+	uint8_t* buf; /* Executable view of the code buffer */
+	uint8_t* wbuf; /* Writable view of the same memory */
+	size_t used;
+	uint32_t break_pc; /* run_until_pc target */
+};
+
+typedef struct Emitter
+{
+	uint8_t* p;
+	unsigned int cycles; /* Cycles of native code not yet added to c->c */
+	unsigned int page; /* Dirty page the block runs from */
+	uint8_t* body; /* First instruction, where a jump back to the block start goes */
+	uint8_t* budget; /* imm32 of the loop check, patched with the block's cycles */
+} Emitter;
+
+#define WORD(X,Y) ((X<<8)|Y)
+#define OFF(field) ((uint8_t)offsetof(CPU, field))
+
+/* B, C, D, E, H, L, (HL), A as encoded in the opcode */
+static const uint8_t RegOff[8]={
+	OFF(reg.B), OFF(reg.C), OFF(reg.D), OFF(reg.E), OFF(reg.H), OFF(reg.L), 0, OFF(reg.A)
+};
+
+/* BC, DE, HL as encoded in bits 4-5 of the opcode */
+static const uint8_t PairOff[3]={
+	OFF(reg.BC), OFF(reg.DE), OFF(reg.HL)
+};
+
+static void e8(Emitter* e, uint8_t b)
+{
+	*e->p++=b;
+}
+
+static void e16(Emitter* e, uint16_t w)
+{
+	e8(e, w&0xFF);
+	e8(e, w>>8);
+}
+
+static void e32(Emitter* e, uint32_t d)
+{
+	e16(e, d&0xFFFF);
+	e16(e, d>>16);
+}
+
+static void e64(Emitter* e, uint64_t q)
+{
+	e32(e, q&0xFFFFFFFF);
+	e32(e, q>>32);
+}
+
+static void emit_cycles(Emitter* e)
+{
+	if(!e->cycles) return;
+	e8(e, 0x48); e8(e, 0x81); e8(e, 0x43); e8(e, OFF(c)); e32(e, e->cycles); /* add qword [rbx+c], imm32 */
+	e->cycles=0;
+}
+
+static void emit_set_pc(Emitter* e, uint16_t pc)
+{
+	e8(e, 0x66); e8(e, 0xC7); e8(e, 0x43); e8(e, OFF(PC)); e16(e, pc); /* mov word [rbx+PC], imm16 */
+}
+
+static void emit_return(Emitter* e)
+{
+	e8(e, 0x5D); /* pop rbp */
+	e8(e, 0x41); e8(e, 0x5C); /* pop r12 */
+	e8(e, 0x5B); /* pop rbx */
+	e8(e, 0xC3); /* ret */
+}
+
+/* Leaves the block when sched.next is no longer the one it was entered with, c->c and PC must be up to date */
+static void emit_check(Emitter* e)
+{
+	uint8_t* go;
+	e8(e, 0x49); e8(e, 0x3B); e8(e, 0xAC); e8(e, 0x24); e32(e, offsetof(MMU, sched.next)); /* cmp rbp, [r12+sched.next] */
+	e8(e, 0x74); e8(e, 0); go=e->p; /* je go */
+	emit_return(e);
+	go[-1]=e->p-go;
+}
+
+/* Leaves the block when a store has marked its own page, the rest of it may be stale */
+static void emit_check_dirty(Emitter* e)
+{
+	uint8_t* go;
+	e8(e, 0x41); e8(e, 0xF6); e8(e, 0x84); e8(e, 0x24); e32(e, offsetof(MMU, jit_dirty)+(e->page>>3)); e8(e, 1<<(e->page&7)); /* test byte [r12+jit_dirty+page/8], bit */
+	e8(e, 0x74); e8(e, 0); go=e->p; /* jz go */
+	emit_return(e);
+	go[-1]=e->p-go;
+}
+
+/*
+ * Calls the handler and adds the cycles the dispatch would charge after
+ * it, which leaves c->c and PC exact so the block can stop right there:
+ * when sched.next moved, or when the handler stored into the block's own
+ * page.
+ */
+static void emit_call(Emitter* e, OpCode fn, uint16_t pc, unsigned int cycles)
+{
+	emit_cycles(e);
+	emit_set_pc(e, pc);
+	e8(e, 0x48); e8(e, 0x89); e8(e, 0xDF); /* mov rdi, rbx */
+	e8(e, 0x4C); e8(e, 0x89); e8(e, 0xE6); /* mov rsi, r12 */
+	e8(e, 0x48); e8(e, 0xB8); e64(e, (uint64_t)(uintptr_t)fn); /* mov rax, fn */
+	e8(e, 0xFF); e8(e, 0xD0); /* call rax */
+	e->cycles=cycles;
+	emit_cycles(e);
+	emit_check(e);
+	emit_check_dirty(e);
+}
+
+/* emit_call on a fallback path, the caller adds the cycles for both paths */
+static void emit_slow(Emitter* e, OpCode fn, uint16_t pc, unsigned int cycles)
+{
+	emit_call(e, fn, pc, cycles);
+	e8(e, 0x48); e8(e, 0x81); e8(e, 0x6B); e8(e, OFF(c)); e32(e, cycles); /* sub qword [rbx+c], imm32 */
+}
+
+/*
+ * cl=(pair) through the page table, the code that uses it follows and is
+ * closed with emit_load_end. A page without a pointer runs the handler of
+ * op instead, which charges the cycles of op in case it leaves the block
+ * and takes them back after, since the caller adds them for both paths.
+ */
+static uint8_t* emit_load_begin(Emitter* e, uint8_t pair)
+{
+	uint8_t* slow;
+	emit_cycles(e);
+	e8(e, 0x0F); e8(e, 0xB7); e8(e, 0x43); e8(e, pair); /* movzx eax, word [rbx+pair] */
+	e8(e, 0x89); e8(e, 0xC1); /* mov ecx, eax */
+	e8(e, 0xC1); e8(e, 0xE9); e8(e, PAGE_SHIFT); /* shr ecx, PAGE_SHIFT */
+	e8(e, 0x49); e8(e, 0x8B); e8(e, 0x14); e8(e, 0xCC); /* mov rdx, [r12+rcx*8], m->rd[page] */
+	e8(e, 0x48); e8(e, 0x85); e8(e, 0xD2); /* test rdx, rdx */
+	e8(e, 0x74); e8(e, 0); slow=e->p; /* jz slow */
+	e8(e, 0x25); e32(e, PAGE_SIZE-1); /* and eax, PAGE_SIZE-1 */
+	e8(e, 0x0F); e8(e, 0xB6); e8(e, 0x0C); e8(e, 0x02); /* movzx ecx, byte [rdx+rax] */
+	return slow;
+}
+
+static void emit_load_end(Emitter* e, uint8_t* slow, uint8_t op, uint16_t p)
+{
+	uint8_t* done;
+	e8(e, 0xEB); e8(e, 0); done=e->p; /* jmp done */
+	slow[-1]=e->p-slow;
+	emit_slow(e, OpCodes[op], p+1, OpInfos[op].cycles);
+	done[-1]=e->p-done;
+}
+
+/* F=(F&keep)|al */
+static void emit_flags(Emitter* e, uint8_t keep)
+{
+	e8(e, 0x8A); e8(e, 0x4B); e8(e, OFF(reg.F)); /* mov cl, [rbx+F] */
+	e8(e, 0x80); e8(e, 0xE1); e8(e, keep); /* and cl, keep */
+	e8(e, 0x08); e8(e, 0xC1); /* or cl, al */
+	e8(e, 0x88); e8(e, 0x4B); e8(e, OFF(reg.F)); /* mov [rbx+F], cl */
+}
+
+/* rel32 of a jump at at, to the current position */
+static void emit_land(Emitter* e, uint8_t* at)
+{
+	int32_t rel=e->p-at;
+	memcpy(at-4, &rel, 4);
+}
+
+/* Leaves the block with PC at pc after adding cycles */
+static void emit_exit(Emitter* e, uint16_t pc, unsigned int cycles)
+{
+	e->cycles=cycles;
+	emit_cycles(e);
+	emit_set_pc(e, pc);
+	emit_return(e);
+}
+
+/*
+ * Stores cl to the address in eax through the page table and sets the
+ * same dirty marks as mmu_write, then steps HL by step. I/O pages and IE
+ * run the handler of op instead. A store into the block's own page
+ * leaves it at next, like emit_check_dirty after a handler.
+ */
+static void emit_store(Emitter* e, uint8_t op, uint16_t p, uint16_t next, int step)
+{
+	uint8_t *slow1, *slow2, *done, *own;
+	emit_cycles(e);
+	e8(e, 0x89); e8(e, 0xC2); /* mov edx, eax */
+	e8(e, 0xC1); e8(e, 0xEA); e8(e, PAGE_SHIFT); /* shr edx, PAGE_SHIFT */
+	e8(e, 0x49); e8(e, 0x8B); e8(e, 0x94); e8(e, 0xD4); e32(e, offsetof(MMU, wr)); /* mov rdx, [r12+wr+rdx*8] */
+	e8(e, 0x48); e8(e, 0x85); e8(e, 0xD2); /* test rdx, rdx */
+	e8(e, 0x0F); e8(e, 0x84); e32(e, 0); slow1=e->p; /* jz slow */
+	e8(e, 0x3D); e32(e, MMU_IE); /* cmp eax, MMU_IE */
+	e8(e, 0x0F); e8(e, 0x84); e32(e, 0); slow2=e->p; /* je slow */
+	e8(e, 0x89); e8(e, 0xC6); /* mov esi, eax */
+	e8(e, 0x83); e8(e, 0xE6); e8(e, PAGE_SIZE-1); /* and esi, PAGE_SIZE-1 */
+	e8(e, 0x88); e8(e, 0x0C); e8(e, 0x32); /* mov [rdx+rsi], cl */
+	if(step)
+	{
+		e8(e, 0x66); e8(e, 0xFF); e8(e, step<0 ? 0x4B : 0x43); e8(e, OFF(reg.HL)); /* inc/dec word [rbx+HL] */
+	}
+	/* mmu_dirty_page folds the echo of WRAM */
+	e8(e, 0x89); e8(e, 0xC2); /* mov edx, eax */
+	e8(e, 0xC1); e8(e, 0xEA); e8(e, DIRTY_SHIFT); /* shr edx, DIRTY_SHIFT */
+	e8(e, 0x8D); e8(e, 0xB2); e32(e, -(0xE000>>DIRTY_SHIFT)); /* lea esi, [rdx-E0] */
+	e8(e, 0x83); e8(e, 0xFE); e8(e, (0xFE00-0xE000)>>DIRTY_SHIFT); /* cmp esi, 1E */
+	e8(e, 0x73); e8(e, 3); /* jae over the sub */
+	e8(e, 0x83); e8(e, 0xEA); e8(e, 0x2000>>DIRTY_SHIFT); /* sub edx, 20 */
+	/* Byte and bit of the page, bts with a register offset into memory is far slower */
+	e8(e, 0x89); e8(e, 0xD6); /* mov esi, edx */
+	e8(e, 0xC1); e8(e, 0xEE); e8(e, 3); /* shr esi, 3 */
+	e8(e, 0x89); e8(e, 0xD1); /* mov ecx, edx */
+	e8(e, 0x83); e8(e, 0xE1); e8(e, 7); /* and ecx, 7 */
+	e8(e, 0xB0); e8(e, 1); /* mov al, 1 */
+	e8(e, 0xD2); e8(e, 0xE0); /* shl al, cl */
+	e8(e, 0x41); e8(e, 0x08); e8(e, 0x84); e8(e, 0x34); e32(e, offsetof(MMU, dirty)); /* or [r12+rsi+dirty], al */
+	e8(e, 0x41); e8(e, 0x08); e8(e, 0x84); e8(e, 0x34); e32(e, offsetof(MMU, jit_dirty)); /* or [r12+rsi+jit_dirty], al */
+	e8(e, 0x81); e8(e, 0xFA); e32(e, e->page); /* cmp edx, page */
+	e8(e, 0x75); e8(e, 0); own=e->p; /* jne done */
+	emit_exit(e, next, OpInfos[op].cycles);
+	own[-1]=e->p-own;
+	e8(e, 0xE9); e32(e, 0); done=e->p; /* jmp done */
+	emit_land(e, slow1);
+	emit_land(e, slow2);
+	emit_slow(e, OpCodes[op], p+1, OpInfos[op].cycles);
+	emit_land(e, done);
+}
+
+/* BIT, RES and SET on a register, returns 0 for the rest of the CB page */
+static int emit_cb(Emitter* e, uint8_t op)
+{
+	uint8_t reg=RegOff[op&7];
+	uint8_t bit=1<<((op>>3)&7);
+	if((op&7)==6) return 0;
+	switch(op>>6)
+	{
+		case 1: /* BIT b,r */
+			e8(e, 0xF6); e8(e, 0x43); e8(e, reg); e8(e, bit); /* test byte [rbx+r], bit */
+			e8(e, 0x0F); e8(e, 0x94); e8(e, 0xC0); /* sete al */
+			e8(e, 0xC0); e8(e, 0xE0); e8(e, 7); /* shl al, 7 */
+			e8(e, 0x0C); e8(e, HALFCARRY); /* or al, H */
+			emit_flags(e, CARRY|0x0F);
+			return 1;
+		case 2: /* RES b,r */
+			e8(e, 0x80); e8(e, 0x63); e8(e, reg); e8(e, (uint8_t)~bit); /* and byte [rbx+r], ~bit */
+			return 1;
+		case 3: /* SET b,r */
+			e8(e, 0x80); e8(e, 0x4B); e8(e, reg); e8(e, bit); /* or byte [rbx+r], bit */
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * A op=cl for op 0x80-0xBF and their immediate forms, bits 3-5 select
+ * ADD, ADC, SUB, SBC, AND, XOR, OR or CP. SUB A,A has been handled by
+ * the caller, SUBr_r sees its operand cleared there.
+ */
+static void emit_alu(Emitter* e, uint8_t op)
+{
+	static const void* const Table[8]={AluAdd, AluAdd, AluSub, AluSbc, 0, 0, 0, AluCp};
+	uint8_t kind=(op>>3)&7;
+	if(kind>=4 && kind<=6)
+	{
+		/* AND, XOR and OR set Z from the result, AND also sets H */
+		static const uint8_t Alu[3]={0x20, 0x30, 0x08};
+		e8(e, 0x8A); e8(e, 0x43); e8(e, OFF(reg.A)); /* mov al, [rbx+A] */
+		e8(e, Alu[kind-4]); e8(e, 0xC8); /* and/xor/or al, cl */
+		e8(e, 0x88); e8(e, 0x43); e8(e, OFF(reg.A)); /* mov [rbx+A], al */
+		e8(e, 0x84); e8(e, 0xC0); /* test al, al */
+		e8(e, 0x0F); e8(e, 0x94); e8(e, 0xC0); /* sete al */
+		e8(e, 0xC0); e8(e, 0xE0); e8(e, 7); /* shl al, 7 */
+		if(kind==4)
+		{
+			e8(e, 0x0C); e8(e, HALFCARRY); /* or al, H */
+		}
+		emit_flags(e, 0x0F);
+		return;
+	}
+	if(kind==1)
+	{
+		e8(e, 0x0F); e8(e, 0xB6); e8(e, 0x43); e8(e, OFF(reg.F)); /* movzx eax, byte [rbx+F] */
+		e8(e, 0xC1); e8(e, 0xE8); e8(e, 4); /* shr eax, 4 */
+		e8(e, 0x83); e8(e, 0xE0); e8(e, 1); /* and eax, 1 */
+		e8(e, 0x00); e8(e, 0xC1); /* add cl, al */
+	}
+	e8(e, 0x0F); e8(e, 0xB6); e8(e, 0x43); e8(e, OFF(reg.A)); /* movzx eax, byte [rbx+A] */
+	e8(e, 0xC1); e8(e, 0xE0); e8(e, 8); /* shl eax, 8 */
+	e8(e, 0x09); e8(e, 0xC8); /* or eax, ecx */
+	e8(e, 0x48); e8(e, 0xBA); e64(e, (uint64_t)(uintptr_t)Table[kind]); /* mov rdx, table */
+	if(kind==7)
+	{
+		/* CP never clears H */
+		e8(e, 0x0F); e8(e, 0xB6); e8(e, 0x04); e8(e, 0x02); /* movzx eax, byte [rdx+rax] */
+		emit_flags(e, HALFCARRY|0x0F);
+		return;
+	}
+	e8(e, 0x0F); e8(e, 0xB7); e8(e, 0x04); e8(e, 0x42); /* movzx eax, word [rdx+rax*2] */
+	e8(e, 0x88); e8(e, 0x63); e8(e, OFF(reg.A)); /* mov [rbx+A], ah */
+	emit_flags(e, 0x0F);
+}
+
+/* Conditional jump to target, not taken leaves PC at next */
+static void emit_branch(Emitter* e, uint8_t op, uint16_t next, uint16_t target)
+{
+	uint8_t mask=(op & 0x10) ? CARRY : ZERO;
+	uint8_t taken_if_set=op & 0x08;
+	emit_set_pc(e, next);
+	e8(e, 0xF6); e8(e, 0x43); e8(e, OFF(reg.F)); e8(e, mask); /* test byte [rbx+F], mask */
+	e8(e, taken_if_set ? 0x74 : 0x75); e8(e, 14); /* jz/jnz over the next mov and add */
+	emit_set_pc(e, target);
+	e8(e, 0x48); e8(e, 0x81); e8(e, 0x43); e8(e, OFF(c)); e32(e, OpInfos[op].taken-OpInfos[op].cycles); /* add qword [rbx+c], imm32 */
+}
+
+/* Target of a jump, -1 for any other op */
+static int jump_target(const uint8_t* g, uint16_t p, uint8_t op)
+{
+	switch(op)
+	{
+		case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: /* JR n, JR cc,n */
+			return (uint16_t)(p+2+(int8_t)g[1]);
+		case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA: /* JP nn, JP cc,nn */
+			return WORD(g[2], g[1]);
+	}
+	return -1;
+}
+
+/*
+ * A jump back to the start of the block, the caller has checked that it
+ * goes there. It stays in compiled code while the whole block fits
+ * before sched.next and the page still maps the same memory, which is
+ * what jit_execute would check before calling the block again. The
+ * budget is patched with the cycles of the block once they are known.
+ */
+static void emit_loop(Emitter* e, uint8_t op, uint16_t pc, uint16_t next, const uint8_t* base)
+{
+	uint8_t *out=0, *late, *moved;
+	int32_t rel;
+	e->cycles+=OpInfos[op].cycles;
+	emit_cycles(e);
+	if((op&0xE7)==0x20 || (op&0xE7)==0xC2) /* JR cc,n, JP cc,nn */
+	{
+		e8(e, 0xF6); e8(e, 0x43); e8(e, OFF(reg.F)); e8(e, (op & 0x10) ? CARRY : ZERO); /* test byte [rbx+F], mask */
+		e8(e, 0x0F); e8(e, (op & 0x08) ? 0x84 : 0x85); e32(e, 0); out=e->p; /* jz/jnz out */
+		e8(e, 0x48); e8(e, 0x81); e8(e, 0x43); e8(e, OFF(c)); e32(e, OpInfos[op].taken-OpInfos[op].cycles); /* add qword [rbx+c], imm32 */
+	}
+	e8(e, 0x48); e8(e, 0x8B); e8(e, 0x43); e8(e, OFF(c)); /* mov rax, [rbx+c] */
+	e8(e, 0x48); e8(e, 0x05); e32(e, 0); e->budget=e->p-4; /* add rax, imm32 */
+	e8(e, 0x49); e8(e, 0x3B); e8(e, 0x84); e8(e, 0x24); e32(e, offsetof(MMU, sched.next)); /* cmp rax, [r12+sched.next] */
+	e8(e, 0x77); e8(e, 0); late=e->p; /* ja leave */
+	e8(e, 0x48); e8(e, 0xB8); e64(e, (uint64_t)(uintptr_t)base); /* mov rax, base */
+	e8(e, 0x49); e8(e, 0x3B); e8(e, 0x84); e8(e, 0x24); e32(e, offsetof(MMU, rd)+(pc>>PAGE_SHIFT)*sizeof(uint8_t*)); /* cmp rax, [r12+rd+page*8] */
+	e8(e, 0x75); e8(e, 0); moved=e->p; /* jne leave */
+	e8(e, 0xE9); e32(e, 0); /* jmp body */
+	rel=e->body-e->p;
+	memcpy(e->p-4, &rel, 4);
+	late[-1]=e->p-late;
+	moved[-1]=e->p-moved;
+	emit_set_pc(e, pc);
+	emit_return(e);
+	if(out)
+	{
+		emit_land(e, out);
+		emit_set_pc(e, next);
+		emit_return(e);
+	}
+}
+
+/* Emits op natively if it is one of the simple ones, returns 0 otherwise.
+ * The caller adds the not taken cycles from OpInfos. */
+static int emit_native(Emitter* e, const uint8_t* g, uint16_t p, uint8_t op)
+{
+	uint8_t lsb=g[1];
+	uint8_t msb=g[2];
+	uint8_t dst=(op>>3)&7;
+	uint8_t src=op&7;
+	uint8_t* slow;
+	if(op==0x00) return 1; /* NOP */
+	if(op>=0x70 && op<0x78 && op!=0x76) /* LD (HL),r */
+	{
+		e8(e, 0x0F); e8(e, 0xB7); e8(e, 0x43); e8(e, OFF(reg.HL)); /* movzx eax, word [rbx+HL] */
+		e8(e, 0x8A); e8(e, 0x4B); e8(e, RegOff[src]); /* mov cl, [rbx+src] */
+		emit_store(e, op, p, p+1, 0);
+		return 1;
+	}
+	if(op>=0x40 && op<0x80 && op!=0x76 && dst!=6)
+	{
+		if(src==6) /* LD r,(HL) */
+		{
+			slow=emit_load_begin(e, OFF(reg.HL));
+			e8(e, 0x88); e8(e, 0x4B); e8(e, RegOff[dst]); /* mov [rbx+dst], cl */
+			emit_load_end(e, slow, op, p);
+		}
+		else if(src!=dst) /* LD r,r */
+		{
+			e8(e, 0x8A); e8(e, 0x43); e8(e, RegOff[src]); /* mov al, [rbx+src] */
+			e8(e, 0x88); e8(e, 0x43); e8(e, RegOff[dst]); /* mov [rbx+dst], al */
+		}
+		return 1;
+	}
+	if(op>=0x80 && op<0xC0) /* ALU A,r and A,(HL) */
+	{
+		if(src==6)
+		{
+			slow=emit_load_begin(e, OFF(reg.HL));
+			emit_alu(e, op);
+			emit_load_end(e, slow, op, p);
+			return 1;
+		}
+		if(op==0x97) /* SUB A */
+		{
+			e8(e, 0xC6); e8(e, 0x43); e8(e, OFF(reg.A)); e8(e, 0); /* mov byte [rbx+A], 0 */
+		}
+		e8(e, 0x0F); e8(e, 0xB6); e8(e, 0x4B); e8(e, RegOff[src]); /* movzx ecx, byte [rbx+src] */
+		emit_alu(e, op);
+		return 1;
+	}
+	if((op&0xC7)==0xC6) /* ALU A,n */
+	{
+		e8(e, 0xB9); e32(e, lsb); /* mov ecx, imm32 */
+		emit_alu(e, op);
+		return 1;
+	}
+	if((op&0xC6)==0x04 && dst!=6) /* INC r, DEC r */
+	{
+		e8(e, 0x0F); e8(e, 0xB6); e8(e, 0x43); e8(e, RegOff[dst]); /* movzx eax, byte [rbx+r] */
+		e8(e, 0x48); e8(e, 0xBA); e64(e, (uint64_t)(uintptr_t)((op&1) ? AluDec : AluInc)); /* mov rdx, table */
+		e8(e, 0x8A); e8(e, 0x4B); e8(e, OFF(reg.F)); /* mov cl, [rbx+F] */
+		e8(e, 0x80); e8(e, 0xE1); e8(e, CARRY|0x0F); /* and cl, C */
+		e8(e, 0x0A); e8(e, 0x0C); e8(e, 0x02); /* or cl, [rdx+rax] */
+		e8(e, 0x88); e8(e, 0x4B); e8(e, OFF(reg.F)); /* mov [rbx+F], cl */
+		e8(e, 0xFE); e8(e, (op&1) ? 0x4B : 0x43); e8(e, RegOff[dst]); /* inc/dec byte [rbx+r] */
+		return 1;
+	}
+	switch(op)
+	{
+		case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x3E: /* LD r,n */
+			e8(e, 0xC6); e8(e, 0x43); e8(e, RegOff[dst]); e8(e, lsb); /* mov byte [rbx+dst], imm8 */
+			return 1;
+		case 0x01: case 0x11: case 0x21: case 0x31: /* LD rr,nn, LD SP,nn */
+			e8(e, 0x66); e8(e, 0xC7); e8(e, 0x43); e8(e, op==0x31 ? OFF(SP) : PairOff[op>>4]); e8(e, lsb); e8(e, msb); /* mov word [rbx+rr], imm16 */
+			return 1;
+		case 0x0A: case 0x1A: /* LD A,(BC), LD A,(DE) */
+			slow=emit_load_begin(e, PairOff[op>>4]);
+			e8(e, 0x88); e8(e, 0x4B); e8(e, OFF(reg.A)); /* mov [rbx+A], cl */
+			emit_load_end(e, slow, op, p);
+			return 1;
+		case 0x2A: case 0x3A: /* LD A,(HL+), LD A,(HL-), the handler steps HL itself */
+			slow=emit_load_begin(e, OFF(reg.HL));
+			e8(e, 0x88); e8(e, 0x4B); e8(e, OFF(reg.A)); /* mov [rbx+A], cl */
+			e8(e, 0x66); e8(e, 0xFF); e8(e, (op & 0x10) ? 0x4B : 0x43); e8(e, OFF(reg.HL)); /* inc/dec word [rbx+HL] */
+			emit_load_end(e, slow, op, p);
+			return 1;
+		case 0x02: case 0x12: /* LD (BC),A, LD (DE),A */
+		case 0x22: case 0x32: /* LD (HL+),A, LD (HL-),A */
+			e8(e, 0x0F); e8(e, 0xB7); e8(e, 0x43); e8(e, op<0x20 ? PairOff[op>>4] : OFF(reg.HL)); /* movzx eax, word [rbx+pair] */
+			e8(e, 0x8A); e8(e, 0x4B); e8(e, OFF(reg.A)); /* mov cl, [rbx+A] */
+			emit_store(e, op, p, p+1, op==0x22 ? 1 : op==0x32 ? -1 : 0);
+			return 1;
+		case 0x36: /* LD (HL),n */
+			e8(e, 0x0F); e8(e, 0xB7); e8(e, 0x43); e8(e, OFF(reg.HL)); /* movzx eax, word [rbx+HL] */
+			e8(e, 0xB1); e8(e, lsb); /* mov cl, imm8 */
+			emit_store(e, op, p, p+2, 0);
+			return 1;
+		case 0xEA: /* LD (nn),A */
+			e8(e, 0xB8); e32(e, WORD(msb, lsb)); /* mov eax, imm32 */
+			e8(e, 0x8A); e8(e, 0x4B); e8(e, OFF(reg.A)); /* mov cl, [rbx+A] */
+			emit_store(e, op, p, p+3, 0);
+			return 1;
+		case 0xE0: /* LDH (n),A, only HRAM, the I/O registers always take the handler */
+			if(lsb<0x80) return 0;
+			e8(e, 0xB8); e32(e, 0xFF00+lsb); /* mov eax, imm32 */
+			e8(e, 0x8A); e8(e, 0x4B); e8(e, OFF(reg.A)); /* mov cl, [rbx+A] */
+			emit_store(e, op, p, p+2, 0);
+			return 1;
+		case 0x03: case 0x13: case 0x23: /* INC rr */
+		case 0x0B: case 0x1B: case 0x2B: /* DEC rr */
+			e8(e, 0x66); e8(e, 0xFF); e8(e, (op & 0x08) ? 0x4B : 0x43); e8(e, PairOff[op>>4]); /* inc/dec word [rbx+pair] */
+			return 1;
+		case 0x33: case 0x3B: /* INC SP, DEC SP */
+			e8(e, 0x66); e8(e, 0xFF); e8(e, (op & 0x08) ? 0x4B : 0x43); e8(e, OFF(SP)); /* inc/dec word [rbx+SP] */
+			return 1;
+		case 0x18: /* JR n */
+			emit_set_pc(e, p+2+(int8_t)lsb);
+			return 1;
+		case 0x20: case 0x28: case 0x30: case 0x38: /* JR cc,n */
+			emit_branch(e, op, p+2, p+2+(int8_t)lsb);
+			return 1;
+		case 0xC3: /* JP nn */
+			emit_set_pc(e, WORD(msb, lsb));
+			return 1;
+		case 0xC2: case 0xCA: case 0xD2: case 0xDA: /* JP cc,nn */
+			emit_branch(e, op, p+3, WORD(msb, lsb));
+			return 1;
+	}
+	return 0;
+}
+
+static int jit_compile(struct Jit* j, JitBlock* b, MMU* m, uint16_t pc)
+{
+	Emitter e;
+	uint8_t* start;
+	uint16_t p=pc;
+	unsigned int cycles=0;
+	int n, ended=0;
+	/* Blocks stay inside one flat mapped page, I/O pages are interpreted */
+	const uint8_t* base=m->rd[pc>>PAGE_SHIFT];
+	const uint8_t* g=base;
+	if(!g) return 0;
+	g+=pc&(PAGE_SIZE-1);
+	if(JIT_BUFFER-j->used < JIT_BLOCK_CODE) jit_flush(j);
+	start=j->wbuf+j->used;
+	e.p=start;
+	e.cycles=0;
+	e.page=mmu_dirty_page(pc);
+	e8(&e, 0x53); /* push rbx */
+	e8(&e, 0x41); e8(&e, 0x54); /* push r12 */
+	e8(&e, 0x55); /* push rbp, also keeps the stack aligned for calls */
+	e8(&e, 0x48); e8(&e, 0x89); e8(&e, 0xFB); /* mov rbx, rdi */
+	e8(&e, 0x49); e8(&e, 0x89); e8(&e, 0xF4); /* mov r12, rsi */
+	e8(&e, 0x49); e8(&e, 0x8B); e8(&e, 0xAC); e8(&e, 0x24); e32(&e, offsetof(MMU, sched.next)); /* mov rbp, [r12+sched.next] */
+	e.body=e.p;
+	e.budget=0;
+	for(n=0; n<JIT_MAX_OPS && !ended; ++n)
+	{
+		uint16_t o=p-pc; /* p wraps past FFFF in HRAM */
+		uint8_t op=g[o];
+		uint8_t len=OpInfos[op].len;
+		if((n && p==j->break_pc) || !OpCodes[op] || o+len > JIT_MAX_BYTES || (pc&(PAGE_SIZE-1))+o+len > PAGE_SIZE) break;
+		if(op==0xCB)
+		{
+			if(emit_cb(&e, g[o+1])) e.cycles+=ExtOpInfos[g[o+1]].cycles;
+			else emit_call(&e, ExtOps[g[o+1]], p+2, ExtOpInfos[g[o+1]].cycles);
+		}
+		else if(jump_target(g+o, p, op)==pc) emit_loop(&e, op, pc, p+len, base);
+		else if(emit_native(&e, g+o, p, op)) e.cycles+=OpInfos[op].cycles;
+		else emit_call(&e, OpCodes[op], p+1, OpInfos[op].cycles);
+		if(op==0xCB) cycles+=ExtOpInfos[g[o+1]].cycles;
+		else cycles+=OpInfos[op].taken > OpInfos[op].cycles ? OpInfos[op].taken : OpInfos[op].cycles;
+		p+=len;
+		ended=OpInfos[op].flow!=FLOW_NONE;
+	}
+	if(p!=pc)
+	{
+		emit_cycles(&e);
+		if(!ended) emit_set_pc(&e, p);
+		emit_return(&e);
+		j->used+=((e.p-start)+15) & ~15;
+	}
+	if(p==pc) return 0;
+	if(e.budget) memcpy(e.budget, &cycles, 4);
+	b->pc=pc;
+	b->len=p-pc;
+	b->cycles=cycles;
+	b->base=base;
+	memcpy(b->code, g, b->len);
+	b->fn=(JitFn)(j->buf+(start-j->wbuf));
+	j->starts[pc>>6] |= (uint64_t)1<<(pc&63);
+	return 1;
+}
+
+void jit_flush(struct Jit* j)
+{
+	int i;
+	for(i=0; i<JIT_SLOTS; ++i)
+	{
+		j->slot[i].pc=JIT_INVALID;
+	}
+	memset(j->hits, 0, sizeof(j->hits));
+	memset(j->starts, 0, sizeof(j->starts));
+	j->used=0;
+}
+
+struct Jit* jit_create(void)
+{
+	struct Jit* j=malloc(sizeof(struct Jit));
+	int fd;
+	if(!j)
+	{
+		fprintf(stderr, "Failed to allocate JIT\n");
+		exit(EXIT_FAILURE);
+	}
+	fd=memfd_create("jit", MFD_CLOEXEC);
+	if(fd<0 || ftruncate(fd, JIT_BUFFER))
+	{
+		fprintf(stderr, "Failed to create JIT code buffer\n");
+		exit(EXIT_FAILURE);
+	}
+	j->buf=mmap(NULL, JIT_BUFFER, PROT_READ|PROT_EXEC, MAP_SHARED, fd, 0);
+	j->wbuf=mmap(NULL, JIT_BUFFER, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd); /* The mappings keep it alive */
+	if(j->buf==MAP_FAILED || j->wbuf==MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to map JIT code buffer\n");
+		exit(EXIT_FAILURE);
+	}
+	jit_flush(j);
+	j->break_pc=BREAK_NONE;
+	alu_tables_init();
+	return j;
+}
+
+void jit_destroy(struct Jit* j)
+{
+	munmap(j->buf, JIT_BUFFER);
+	munmap(j->wbuf, JIT_BUFFER);
+	free(j);
+}
+
+/* Drops the blocks starting in addr..addr+len that no longer match memory, len is a multiple of 64 */
+static void jit_check(struct Jit* j, MMU* m, uint16_t addr, unsigned int len)
+{
+	unsigned int w, pc;
+	for(w=addr>>6; w<(addr+len)>>6; ++w)
+	{
+		uint64_t bits=j->starts[w];
+		while(bits)
+		{
+			JitBlock* b;
+			const uint8_t* g;
+			pc=(w<<6)+__builtin_ctzll(bits);
+			bits&=bits-1;
+			b=&j->slot[pc & (JIT_SLOTS-1)];
+			g=m->rd[pc>>PAGE_SHIFT];
+			if(b->pc==pc && b->base==g && !memcmp(b->code, g+(pc&(PAGE_SIZE-1)), b->len)) continue;
+			if(b->pc==pc) b->pc=JIT_INVALID;
+			j->starts[w] &= ~((uint64_t)1<<(pc&63)); /* Dropped, or the slot went to another block */
+		}
+	}
+}
+
+/* Checks the blocks of a page that was stored to, and through the echo of WRAM */
+static void jit_check_page(struct Jit* j, MMU* m, uint16_t pc)
+{
+	unsigned int page=mmu_dirty_page(pc);
+	uint16_t addr=page<<DIRTY_SHIFT;
+	jit_check(j, m, addr, 1<<DIRTY_SHIFT);
+	if(addr >= 0xC000 && addr < 0xDE00) jit_check(j, m, addr+0x2000, 1<<DIRTY_SHIFT);
+	m->jit_dirty[page>>6] &= ~((uint64_t)1<<(page&63));
+}
+
+/* Drops the blocks that run past pc or loop back to it, they start in its page up to it */
+void jit_break(struct Jit* j, uint32_t pc)
+{
+	unsigned int p;
+	j->break_pc=pc;
+	if(pc==BREAK_NONE) return;
+	for(p=pc&~(PAGE_SIZE-1); p<=pc; ++p)
+	{
+		JitBlock* b=&j->slot[p & (JIT_SLOTS-1)];
+		if(b->pc==p && pc-p < b->len) b->pc=JIT_INVALID;
+	}
+}
+
+int jit_execute(CPU* c, MMU* m)
+{
+	struct Jit* j=c->jit;
+	uint16_t pc=c->PC;
+	JitBlock* b=&j->slot[pc & (JIT_SLOTS-1)];
+	unsigned int page=mmu_dirty_page(pc);
+	uint8_t op;
+	if(pc==j->break_pc) return 0;
+	if(c->halt)
+	{
+		execute_next(c,m); /* Sleeps till the next event */
+		return 1;
+	}
+	if((m->jit_dirty[page>>6]>>(page&63))&1) jit_check_page(j, m, pc);
+	if(b->pc==pc && b->base==m->rd[pc>>PAGE_SHIFT])
+	{
+		if(c->c+b->cycles <= m->sched.next)
+		{
+			b->fn(c,m);
+			return 1;
+		}
+	}
+	else if(++j->hits[pc & (JIT_HITS-1)] >= JIT_THRESHOLD)
+	{
+		j->hits[pc & (JIT_HITS-1)]=0;
+		if(jit_compile(j, b, m, pc) && c->c+b->cycles <= m->sched.next)
+		{
+			b->fn(c,m);
+			return 1;
+		}
+	}
+	/* Cold code runs up to its next jump, so blocks start at jump targets */
+	do
+	{
+		op=mmu_read(m, c->PC);
+		execute_next(c,m);
+	} while(OpInfos[op].flow==FLOW_NONE && c->PC!=j->break_pc && c->c < m->sched.next && !c->halt);
+	return 1;
+}
+#endif
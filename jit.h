@@ -0,0 +1,19 @@
+#ifndef TAPIBOYJIT
+#define TAPIBOYJIT
+
+#include "cpu.h"
+
+/*
+ * x86-64 dynamic recompiler, selected with -DJIT.
+ * jit_execute replaces execute_next in the main loop: it runs a compiled
+ * block when one exists for PC and otherwise interprets up to the next
+ * jump, compiling the block once PC has been hit often enough.
+ */
+
+struct Jit* jit_create(void);
+void jit_flush(struct Jit* j);
+void jit_destroy(struct Jit* j);
+void jit_break(struct Jit* j, uint32_t pc); /* Blocks end before pc, BREAK_NONE clears it */
+int jit_execute(CPU* c, MMU* m); /* 0 without running anything when PC is the breakpoint */
+
+#endif
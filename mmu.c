@@ -0,0 +1,88 @@
+#include <string.h>
+#include "mmu.h"
+#include "io.h"
+#include "irq.h"
+#include "cart.h"
+#include "sched.h"
+
+/* Pages that are not mapped flat still live in mem until they get their own handlers */
+static uint8_t mem_read(MMU* m, uint16_t addr)
+{
+	return m->mem[addr-MEM_BASE];
+}
+
+static void mem_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	m->mem[addr-MEM_BASE]=val;
+}
+
+/* Nothing drives the bus without a cartridge */
+static uint8_t open_bus_read(MMU* m, uint16_t addr)
+{
+	return 0xFF;
+}
+
+/* Writes to ROM are dropped until a mapper claims them */
+static void open_bus_write(MMU* m, uint16_t addr, uint8_t val)
+{
+}
+
+/* Slow paths of mmu_read/mmu_write, kept out of line */
+uint8_t mmu_read_io(MMU* m, uint16_t addr)
+{
+	return m->io_rd[addr>>PAGE_SHIFT](m, addr);
+}
+
+void mmu_write_io(MMU* m, uint16_t addr, uint8_t val)
+{
+	if(addr==MMU_IE) irq_write(m, addr, val);
+	else m->io_wr[addr>>PAGE_SHIFT](m, addr, val);
+}
+
+/* Points the pages of addr..addr+len at rd and wr, 0 leaves them to the callbacks */
+void mmu_map(MMU* m, uint16_t addr, unsigned int len, uint8_t* rd, uint8_t* wr)
+{
+	unsigned int i;
+	for(i=0; i<len; i+=PAGE_SIZE)
+	{
+		m->rd[(addr+i)>>PAGE_SHIFT]=rd ? rd+i : 0;
+		m->wr[(addr+i)>>PAGE_SHIFT]=wr ? wr+i : 0;
+	}
+}
+
+void mmu_map_io(MMU* m, uint16_t addr, unsigned int len, MemRead io_rd, MemWrite io_wr)
+{
+	unsigned int i;
+	for(i=0; i<len; i+=PAGE_SIZE)
+	{
+		m->io_rd[(addr+i)>>PAGE_SHIFT]=io_rd;
+		m->io_wr[(addr+i)>>PAGE_SHIFT]=io_wr;
+	}
+}
+
+void mmu_init(MMU* m, uint64_t* clock, uint8_t* ime)
+{
+	memset(m->mem, 0, sizeof(m->mem)); /* The registers io_init reads start out clear */
+	m->clock=clock;
+	m->ime=ime;
+	m->irq=0;
+	memset(&m->cart, 0, sizeof(m->cart));
+	m->cart.save_fd=-1;
+	m->cart.flush_frames=SAVE_FLUSH_DEFAULT;
+	memset(&m->dma, 0, sizeof(m->dma));
+	sched_init(m);
+#ifdef DIRTY_PAGES
+	mmu_clean(m);
+#endif
+#ifdef JIT
+	memset(m->jit_dirty, 0, sizeof(m->jit_dirty));
+#endif
+	mmu_map_io(m, 0x0000, 0x8000, open_bus_read, open_bus_write);
+	mmu_map_io(m, 0x8000, 0x8000, mem_read, mem_write);
+	mmu_map(m, 0x0000, 0x8000, 0, 0); /* ROM */
+	mmu_map(m, 0x8000, 0x6000, m->mem, m->mem); /* VRAM, cartridge RAM, WRAM */
+	mmu_map(m, 0xE000, 0x1E00, m->mem+(0xC000-MEM_BASE), m->mem+(0xC000-MEM_BASE)); /* Echo of C000-DDFF */
+	mmu_map(m, 0xFE00, 0x100, m->mem+(0xFE00-MEM_BASE), m->mem+(0xFE00-MEM_BASE)); /* OAM */
+	mmu_map(m, 0xFF80, 0x80, m->mem+(0xFF80-MEM_BASE), m->mem+(0xFF80-MEM_BASE)); /* HRAM and IE, mmu_write catches stores to IE */
+	io_init(m);
+}
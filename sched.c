@@ -0,0 +1,124 @@
+#include "sched.h"
+#include "dma.h"
+#include "timer.h"
+#include "irq.h"
+
+
+static const EventFn Events[EVENT_KINDS]={
+	[EV_OAM_DMA]=dma_oam_end,
+	[EV_HDMA]=hdma_hblank,
+	[EV_TIMER]=timer_overflow,
+	[EV_EI]=irq_ei
+};
+
+static void sched_swap(Sched* s, int i, int j)
+{
+	Event e=s->heap[i];
+	s->heap[i]=s->heap[j];
+	s->heap[j]=e;
+	s->pos[s->heap[i].kind]=i;
+	s->pos[s->heap[j].kind]=j;
+}
+
+static void sched_up(Sched* s, int i)
+{
+	while(i && s->heap[i].when < s->heap[(i-1)/2].when)
+	{
+		sched_swap(s, i, (i-1)/2);
+		i=(i-1)/2;
+	}
+}
+
+static void sched_down(Sched* s, int i)
+{
+	for(;;)
+	{
+		int min=i, l=2*i+1, r=2*i+2;
+		if(l < s->count && s->heap[l].when < s->heap[min].when) min=l;
+		if(r < s->count && s->heap[r].when < s->heap[min].when) min=r;
+		if(min==i) return;
+		sched_swap(s, i, min);
+		i=min;
+	}
+}
+
+static void sched_remove(Sched* s, int i)
+{
+	s->pos[s->heap[i].kind]=EVENT_IDLE;
+	if(i==--s->count) return;
+	s->heap[i]=s->heap[s->count];
+	s->pos[s->heap[i].kind]=i;
+	sched_up(s, i);
+	sched_down(s, s->pos[s->heap[i].kind]);
+}
+
+/*
+ * An event can stall the CPU past the limit, next then stays there so the
+ * run ends. A pending interrupt holds next at 0 until it is taken.
+ */
+void sched_update(MMU* m)
+{
+	Sched* s=&m->sched;
+	if(m->irq)
+	{
+		s->next=0;
+		return;
+	}
+	s->next=s->limit;
+	if(s->count && s->heap[0].when < s->next) s->next=s->heap[0].when;
+}
+
+void sched_init(MMU* m)
+{
+	Sched* s=&m->sched;
+	int i;
+	s->count=0;
+	for(i=0; i<EVENT_KINDS; ++i)
+	{
+		s->pos[i]=EVENT_IDLE;
+	}
+	s->limit=UINT64_MAX; /* Outside a run */
+	sched_update(m);
+}
+
+void sched_add(MMU* m, uint8_t kind, uint64_t when)
+{
+	Sched* s=&m->sched;
+	int i=s->pos[kind];
+	if(i==EVENT_IDLE)
+	{
+		i=s->count++;
+		s->heap[i].kind=kind;
+		s->pos[kind]=i;
+	}
+	s->heap[i].when=when;
+	sched_up(s, i);
+	sched_down(s, s->pos[kind]);
+	sched_update(m);
+}
+
+void sched_cancel(MMU* m, uint8_t kind)
+{
+	Sched* s=&m->sched;
+	if(s->pos[kind]==EVENT_IDLE) return;
+	sched_remove(s, s->pos[kind]);
+	sched_update(m);
+}
+
+void sched_run(MMU* m)
+{
+	Sched* s=&m->sched;
+	while(s->count && s->heap[0].when <= *m->clock)
+	{
+		Event e=s->heap[0];
+		sched_remove(s, 0);
+		Events[e.kind](m, e.when);
+	}
+	sched_update(m);
+}
+
+void sched_limit(MMU* m, uint64_t limit)
+{
+	m->sched.limit=limit;
+	sched_update(m);
+}
@@ -0,0 +1,25 @@
+#ifndef TAPIBOYSCHED
+#define TAPIBOYSCHED
+
+#include "mmu.h"
+
+/*
+ * Peripherals do not run along with the CPU. They put an event on the
+ * clock instead, and the run loops compare the clock against sched.next
+ * once per instruction. sched.next is also where the current run ends,
+ * so that one compare covers both. An event fires at the first
+ * instruction boundary at or past when, and gets when so it can schedule
+ * the next one without drifting.
+ */
+#define EVENT_IDLE 0xFF
+
+typedef void(*EventFn)(MMU* m, uint64_t when);
+
+void sched_init(MMU* m);
+void sched_add(MMU* m, uint8_t kind, uint64_t when); /* Moves the event if it is pending */
+void sched_cancel(MMU* m, uint8_t kind);
+void sched_run(MMU* m); /* Fires the events that are due */
+void sched_limit(MMU* m, uint64_t limit); /* Starts a run that ends at limit */
+void sched_update(MMU* m); /* Recomputes next */
+
+#endif
@@ -0,0 +1,124 @@
+#include "timer.h"
+#include "sched.h"
+#include "irq.h"
+
+#define TIMA 0xFF05
+#define TMA 0xFF06
+#define TAC 0xFF07
+#define TAC_ON 0x04
+
+/* TIMA counts falling edges of this bit of the divider, 4096, 262144, 65536 and 16384 Hz */
+static const uint8_t TacBit[4]={9, 3, 5, 7};
+
+/* Falling edges of the selected divider bit from the last reset up to clock */
+static uint64_t timer_ticks(MMU* m, uint64_t clock)
+{
+	return (clock-m->timer.div_base)>>(TacBit[REG(TAC)&3]+1);
+}
+
+/* Whether the selected divider bit is high, a reset or TAC write that drops it ticks TIMA */
+static int timer_edge(MMU* m, uint64_t clock)
+{
+	return (REG(TAC)&TAC_ON) && ((clock-m->timer.div_base)>>TacBit[REG(TAC)&3]&1);
+}
+
+/* TIMA past FF starts again from TMA, as often as it went over */
+static void timer_add(MMU* m, uint64_t n)
+{
+	Timer* t=&m->timer;
+	uint64_t v=t->tima+n;
+	if(v > 0xFF)
+	{
+		v=REG(TMA)+(v-0x100)%(0x100-REG(TMA));
+		irq_request(m, INT_TIMER);
+	}
+	t->tima=v;
+}
+
+/*
+ * Brings tima up to clock under the current TAC. A read can get there
+ * before a late overflow event, which then finds nothing left to do.
+ */
+static void timer_sync(MMU* m, uint64_t clock)
+{
+	Timer* t=&m->timer;
+	if(clock < t->sync) return;
+	if(REG(TAC)&TAC_ON) timer_add(m, timer_ticks(m, clock)-timer_ticks(m, t->sync));
+	t->sync=clock;
+}
+
+/* Puts the overflow event where tima will pass FF, after any change to the timer */
+static void timer_schedule(MMU* m)
+{
+	Timer* t=&m->timer;
+	uint8_t shift=TacBit[REG(TAC)&3]+1;
+	if(!(REG(TAC)&TAC_ON))
+	{
+		sched_cancel(m, EV_TIMER);
+		return;
+	}
+	sched_add(m, EV_TIMER, t->div_base+((timer_ticks(m, t->sync)+0x100-t->tima)<<shift));
+}
+
+void timer_overflow(MMU* m, uint64_t when)
+{
+	timer_sync(m, when);
+	timer_schedule(m);
+}
+
+uint8_t div_read(MMU* m, uint16_t addr)
+{
+	return (*m->clock-m->timer.div_base)>>8;
+}
+
+/* Any write clears the divider */
+void div_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	Timer* t=&m->timer;
+	uint64_t now=*m->clock;
+	timer_sync(m, now);
+	if(timer_edge(m, now)) timer_add(m, 1);
+	t->div_base=now;
+	t->sync=now;
+	timer_schedule(m);
+}
+
+uint8_t tima_read(MMU* m, uint16_t addr)
+{
+	timer_sync(m, *m->clock);
+	return m->timer.tima;
+}
+
+void tima_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	timer_sync(m, *m->clock);
+	m->timer.tima=val;
+	timer_schedule(m);
+}
+
+void tma_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	timer_sync(m, *m->clock);
+	REG(addr)=val;
+	timer_schedule(m);
+}
+
+void tac_write(MMU* m, uint16_t addr, uint8_t val)
+{
+	uint64_t now=*m->clock;
+	int edge;
+	timer_sync(m, now);
+	edge=timer_edge(m, now);
+	REG(addr)=val&0x07;
+	if(edge && !timer_edge(m, now)) timer_add(m, 1);
+	timer_schedule(m);
+}
+
+void timer_init(MMU* m)
+{
+	Timer* t=&m->timer;
+	t->div_base=*m->clock;
+	t->sync=*m->clock;
+	t->tima=REG(TIMA);
+	timer_schedule(m);
+}
@@ -0,0 +1,21 @@
+#ifndef TAPIBOYTIMER
+#define TAPIBOYTIMER
+
+#include "mmu.h"
+
+/*
+ * DIV, TIMA, TMA and TAC. Nothing ticks: DIV is the clock since the last
+ * reset of the divider, and TIMA is brought up to date from the clock
+ * whenever it is read or the timer registers change. The only event is
+ * the next TIMA overflow, which reloads TMA and requests the interrupt.
+ */
+void timer_init(MMU* m);
+void timer_overflow(MMU* m, uint64_t when); /* EV_TIMER */
+uint8_t div_read(MMU* m, uint16_t addr);
+void div_write(MMU* m, uint16_t addr, uint8_t val);
+uint8_t tima_read(MMU* m, uint16_t addr);
+void tima_write(MMU* m, uint16_t addr, uint8_t val);
+void tma_write(MMU* m, uint16_t addr, uint8_t val);
+void tac_write(MMU* m, uint16_t addr, uint8_t val);
+
+#endif